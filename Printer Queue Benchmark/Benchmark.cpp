@@ -0,0 +1,147 @@
+/*
+Description - Benchmarks for the printer queue simulation.  Runs every engine over a range of fleet sizes and job arrival rates with
+    logging off, then reports the jobs dispatched per second, events processed per second, and memory used per printer, so changes
+    can be compared between versions.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "../Printer Queue/Simulation.h"
+
+//Benchmark Settings
+const int BENCHMARK_PRINTER_COUNTS[] = { 4, 100, 1000, 10000, 100000 };
+const int BENCHMARK_SECONDS_PER_JOB[] = { 1, 30 };
+const int BENCHMARK_JOBS = 100000;//Jobs created in each run
+const int BENCHMARK_SEED = 1;
+const int REAL_TIME_SPEED = 1000000000;//Fast enough that the RealTime engines never wait on the real clock
+//Polling does at most one tick per millisecond however fast the clock runs, so it is run at one tick per millisecond with fewer jobs
+const int POLLING_SPEED = 1000;
+const int POLLING_JOBS = 200;
+
+/// <summary>
+/// Bytes allocated with operator new that haven't been deleted yet, and the most there have been since the last ResetPeakBytes().
+/// </summary>
+static std::atomic<long long> allocatedBytes{ 0 };
+static std::atomic<long long> peakBytes{ 0 };
+
+//Each allocation is prefixed with its size so operator delete can count it
+const size_t ALLOCATION_HEADER_BYTES = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+void* operator new(size_t size) {
+    char* memory = static_cast<char*>(std::malloc(size + ALLOCATION_HEADER_BYTES));
+    if (memory == nullptr)
+        throw std::bad_alloc();
+
+    *reinterpret_cast<size_t*>(memory) = size;
+    long long allocated = allocatedBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed) + static_cast<long long>(size);
+    long long peak = peakBytes.load(std::memory_order_relaxed);
+    while (allocated > peak && !peakBytes.compare_exchange_weak(peak, allocated, std::memory_order_relaxed)) {
+    }
+
+    return memory + ALLOCATION_HEADER_BYTES;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr)
+        return;
+
+    char* memory = static_cast<char*>(pointer) - ALLOCATION_HEADER_BYTES;
+    allocatedBytes.fetch_sub(static_cast<long long>(*reinterpret_cast<size_t*>(memory)), std::memory_order_relaxed);
+    std::free(memory);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* pointer) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+void ResetPeakBytes() {
+    peakBytes.store(allocatedBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+struct BenchmarkCase {
+    const char* name;
+    SimulationEngine engine;
+    FleetBackend fleetBackend;
+    ClockMode clockMode;
+};
+
+const BenchmarkCase BENCHMARK_CASES[] = {
+    { "DiscreteEvent Heap", SimulationEngine::DiscreteEvent, FleetBackend::Heap, ClockMode::Paced },
+    { "DiscreteEvent Arrays", SimulationEngine::DiscreteEvent, FleetBackend::Arrays, ClockMode::Paced },
+    { "RealTime", SimulationEngine::RealTime, FleetBackend::Heap, ClockMode::Paced },
+    { "RealTime Polling", SimulationEngine::RealTime, FleetBackend::Heap, ClockMode::Polling },
+    { "RealTimeThreaded", SimulationEngine::RealTimeThreaded, FleetBackend::Heap, ClockMode::Paced },
+    { "Sharded", SimulationEngine::Sharded, FleetBackend::Heap, ClockMode::Paced }
+};
+
+/// <summary>
+/// Runs one simulation and prints a row of results.
+/// </summary>
+void RunBenchmark(const BenchmarkCase& benchmarkCase, int printers, int secondsPerJob) {
+    bool polling = benchmarkCase.clockMode == ClockMode::Polling;
+    SimulationSettings settings;
+    settings.printers = printers;
+    settings.secondsPerJob = secondsPerJob;
+    settings.secondsToSimulate = (polling ? POLLING_JOBS : BENCHMARK_JOBS) * secondsPerJob;
+    settings.simulationSpeed = polling ? POLLING_SPEED : REAL_TIME_SPEED;
+    settings.engine = benchmarkCase.engine;
+    settings.fleetBackend = benchmarkCase.fleetBackend;
+    settings.clockMode = benchmarkCase.clockMode;
+    settings.seed = BENCHMARK_SEED;
+
+    long long bytesBefore = allocatedBytes.load(std::memory_order_relaxed);
+    ResetPeakBytes();
+    {
+        Simulation simulation;
+        if (!simulation.Setup(settings)) {
+            std::cout << benchmarkCase.name << " failed to set up" << std::endl;
+            return;
+        }
+
+        long long setupBytes = allocatedBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        simulation.Run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        long long runBytes = peakBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+        std::cout << std::left << std::setw(22) << benchmarkCase.name << std::right << std::setw(9) << printers << std::setw(17) << secondsPerJob
+            << std::fixed << std::setprecision(0) << std::setw(14) << simulation.GetJobCount() / seconds << std::setw(14) << simulation.GetEventCount() / seconds
+            << std::setw(17) << static_cast<double>(setupBytes) / printers << std::setw(16) << static_cast<double>(runBytes) / printers
+            << std::setprecision(3) << std::setw(11) << seconds << std::endl;
+    }
+}
+
+int main() {
+    GetDefaultJobSizes();//Built on first use, so build it before measuring anything
+    std::cout << BENCHMARK_JOBS << " jobs per run, " << POLLING_JOBS << " when polling.\n";
+    std::cout << "Engine                 Printers  Seconds Per Job        Jobs/s      Events/s  Setup B/Printer  Peak B/Printer   Time (s)\n";
+    for (const BenchmarkCase& benchmarkCase : BENCHMARK_CASES) {
+        for (int printers : BENCHMARK_PRINTER_COUNTS) {
+            for (int secondsPerJob : BENCHMARK_SECONDS_PER_JOB) {
+                RunBenchmark(benchmarkCase, printers, secondsPerJob);
+            }
+        }
+    }
+
+    return 0;
+}
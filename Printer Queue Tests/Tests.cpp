@@ -0,0 +1,385 @@
+/*
+Description - Regression checks for the printer queue simulation.  Each check is deterministic: it uses fixed seeds and compares
+    results that must match exactly, such as an index against the linear scan it replaced or the events logged by two fleet backends
+    or engines.  Prints a line for each check and returns the number that failed.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../Printer Queue/Simulation.h"
+
+//Test Settings
+const unsigned long long TEST_SEED = 7;
+const int INDEX_PRINTERS = 37;//Not a multiple of a vector width, so the scalar tail of FleetArrays is checked too
+const int INDEX_UPDATES = 20000;
+const long long INDEX_TICKS_PER_SHEET = 1000;
+const int TEST_PRINTERS = 6;
+const double TEST_SECONDS_PER_JOB = 40;//Busy enough that most jobs wait, but not overloaded
+const int TEST_SECONDS_TO_SIMULATE = 4 * SECONDS_PER_MINUTE * MINUTES_PER_HOUR;
+const std::vector<PrinterProfile> MIXED_PROFILES = { { 20 }, { 30, 5000 }, { 45 } };
+const double MIXED_SECONDS_PER_JOB = 8;//The mixed fleet is faster, so it needs more jobs to be as busy
+const double OVERLOADED_SECONDS_PER_JOB = 10;
+const int LIMIT_QUEUE_LENGTH = 3;
+const long long LIMIT_BACKLOG_PAGES = 150;
+const int LIMIT_WORKER_THREADS = 2;
+const int TEST_SHARDED_PRINTERS = 24;
+const int TEST_SHARDS = 4;
+const int TEST_MIGRATION_PAGES = 5;
+const int REAL_TIME_SPEED = 1000000000;//Fast enough that the RealTime engines never wait for the real clock
+
+static int failedChecks = 0;
+
+void Check(const char* name, bool passed, const std::string& detail = "") {
+    std::cout << (passed ? "PASS " : "FAIL ") << name;
+    if (!passed && !detail.empty())
+        std::cout << ": " << detail;
+
+    std::cout << std::endl;
+    if (!passed)
+        failedChecks++;
+}
+
+/// <summary>
+/// The linear scan that DispatchIndex replaced: the first printer with no jobs, otherwise the lowest ID among the printers with the
+/// least pages left.
+/// </summary>
+int ScanLeastPagesLeft(const std::vector<long long>& finishTimes, long long now, long long ticksPerSheet) {
+    int bestID = 0;
+    long long best = 0;
+    for (int i = 0; i < finishTimes.size(); i++) {
+        if (finishTimes[i] == DispatchIndex::NO_JOBS)
+            return i;
+
+        long long pagesLeft = (finishTimes[i] - now + ticksPerSheet - 1) / ticksPerSheet;
+        if (i == 0 || pagesLeft < best) {
+            best = pagesLeft;
+            bestID = i;
+        }
+    }
+
+    return bestID;
+}
+
+/// <summary>
+/// Gives printers new finish times or empties them at random, with many printers tied on pages left, and checks
+/// DispatchIndex and FleetArrays pick the same printer as the linear scan after every update.
+/// </summary>
+void CheckDispatchIndex() {
+    Random random(TEST_SEED);
+    DispatchIndex index;
+    FleetArrays fleetArrays;
+    std::vector<long long> finishTimes(INDEX_PRINTERS, DispatchIndex::NO_JOBS);
+    for (int i = 0; i < INDEX_PRINTERS; i++)
+    {
+        index.Add();
+        fleetArrays.Add();
+    }
+
+    long long now = 0;
+    int mismatches = 0;
+    int arrayMismatches = 0;
+    for (int update = 0; update < INDEX_UPDATES; update++) {
+        now += random.NextInt(0, static_cast<int>(INDEX_TICKS_PER_SHEET / 20));
+        //Printers finish their jobs before new jobs are dispatched, so no finish time is ever before now
+        for (int i = 0; i < INDEX_PRINTERS; i++) {
+            if (finishTimes[i] != DispatchIndex::NO_JOBS && finishTimes[i] <= now) {
+                finishTimes[i] = DispatchIndex::NO_JOBS;
+                index.Update(i, DispatchIndex::NO_JOBS);
+                fleetArrays.Update(i, FleetArrays::NO_JOBS);
+            }
+        }
+
+        int printerID = random.NextInt(0, INDEX_PRINTERS - 1);
+        long long finishTime = random.NextInt(0, 9) == 0 ? DispatchIndex::NO_JOBS : now + random.NextInt(1, 20) * INDEX_TICKS_PER_SHEET + random.NextInt(-1, 1);
+        finishTimes[printerID] = finishTime;
+        index.Update(printerID, finishTime);
+        fleetArrays.Update(printerID, finishTime == DispatchIndex::NO_JOBS ? FleetArrays::NO_JOBS : static_cast<double>(finishTime));
+        int scanned = ScanLeastPagesLeft(finishTimes, now, INDEX_TICKS_PER_SHEET);
+        if (index.SelectLeastPagesLeft(now, INDEX_TICKS_PER_SHEET) != scanned)
+            mismatches++;
+
+        if (fleetArrays.SelectLeastPagesLeft(static_cast<double>(now), static_cast<double>(INDEX_TICKS_PER_SHEET)) != scanned)
+            arrayMismatches++;
+    }
+
+    Check("DispatchIndex picks the same printer as a linear scan", mismatches == 0, std::to_string(mismatches) + " updates differ");
+    Check("FleetArrays picks the same printer as a linear scan", arrayMismatches == 0, std::to_string(arrayMismatches) + " updates differ");
+}
+
+SimulationSettings GetTestSettings() {
+    SimulationSettings settings;
+    settings.printers = TEST_PRINTERS;
+    settings.secondsPerJob = TEST_SECONDS_PER_JOB;
+    settings.secondsToSimulate = TEST_SECONDS_TO_SIMULATE;
+    settings.simulationSpeed = REAL_TIME_SPEED;
+    settings.engine = SimulationEngine::DiscreteEvent;
+    settings.seed = TEST_SEED;
+    return settings;
+}
+
+/// <summary>
+/// The results of a run.  Job times are durations, so they can be compared between runs that started at different real times.
+/// </summary>
+std::string GetResults(Simulation& simulation) {
+    char text[512];
+    std::snprintf(text, sizeof(text), "jobs %d, waits %lld mean %.6f max %lld, latencies %lld mean %.6f p90 %lld, utilization %.9f, "
+        "rejected %lld, deferred %lld, backlog %lld",
+        simulation.GetJobCount(), simulation.GetQueueWaits().Count(), simulation.GetQueueWaits().Mean(), simulation.GetQueueWaits().Max(),
+        simulation.GetLatencies().Count(), simulation.GetLatencies().Mean(), simulation.GetLatencies().GetPercentile(90),
+        simulation.GetUtilization(), simulation.GetRejectedJobs(), simulation.GetDeferredJobs(), simulation.GetBacklog().Pages());
+    return text;
+}
+
+/// <summary>
+/// The job and printer events logged by a run.  Record times aren't compared, since they count from the real time the run started.
+/// </summary>
+struct EventStream {
+    std::vector<LogRecord> records;
+
+    static void Subscriber(const LogRecord* records, size_t count, void* context) {
+        EventStream& stream = *static_cast<EventStream*>(context);
+        for (size_t i = 0; i < count; i++) {
+            if (records[i].type != LogRecordType::Separator)
+                stream.records.push_back(records[i]);
+        }
+    }
+
+    EventStream Filter(LogRecordType type) const {
+        EventStream filtered;
+        for (const LogRecord& record : records) {
+            if (record.type == type)
+                filtered.records.push_back(record);
+        }
+
+        return filtered;
+    }
+
+    /// <summary>
+    /// Puts the records in a fixed order, for runs that log from several threads, such as Sharded, whose records can interleave
+    /// differently each time.
+    /// </summary>
+    EventStream Sort() const {
+        EventStream sorted = *this;
+        std::sort(sorted.records.begin(), sorted.records.end(), [](const LogRecord& a, const LogRecord& b) {
+            return std::tie(a.type, a.printerID, a.jobID, a.pages) < std::tie(b.type, b.printerID, b.jobID, b.pages);
+        });
+        return sorted;
+    }
+
+    /// <returns>Empty if the streams are the same, otherwise where they first differ.</returns>
+    std::string Compare(const EventStream& other) const {
+        size_t count = std::min(records.size(), other.records.size());
+        for (size_t i = 0; i < count; i++) {
+            const LogRecord& a = records[i];
+            const LogRecord& b = other.records[i];
+            if (a.type != b.type || a.printerID != b.printerID || a.jobID != b.jobID || a.pages != b.pages)
+                return "record " + std::to_string(i) + " differs";
+        }
+
+        if (records.size() != other.records.size())
+            return std::to_string(records.size()) + " records against " + std::to_string(other.records.size());
+
+        return records.empty() ? "no records" : "";
+    }
+};
+
+/// <param name="restore">Snapshot to carry on from, or nullptr to start a new run.</param>
+/// <param name="checkpoint">Where to save a snapshot after the run, or nullptr to not save one.</param>
+/// <returns>The results of the run, or why it couldn't run.</returns>
+std::string Run(const SimulationSettings& simulationSettings, EventStream& events, const CheckpointWriter* restore = nullptr,
+    CheckpointWriter* checkpoint = nullptr) {
+    SimulationSettings settings = simulationSettings;
+    Logger logger;
+    logger.Subscribe(EventStream::Subscriber, &events);
+    logger.Start(LogLevel::Off, nullptr);
+    settings.logger = &logger;
+    Simulation simulation;
+    if (!simulation.Setup(settings))
+        return "failed to set up";
+
+    if (restore != nullptr && !simulation.RestoreCheckpoint(restore->Bytes().data(), restore->Bytes().size()))
+        return "failed to restore";
+
+    simulation.Run();
+    logger.Stop();
+    if (checkpoint != nullptr && !simulation.SaveCheckpoint(*checkpoint))
+        return "failed to save";
+
+    return GetResults(simulation);
+}
+
+/// <summary>
+/// Checks two runs log the same events and have the same results.
+/// </summary>
+/// <param name="anyOrder">Only check the runs logged the same records, not that they logged them in the same order.</param>
+void CheckSameRuns(const std::string& name, const SimulationSettings& first, const SimulationSettings& second, bool anyOrder = false) {
+    EventStream firstEvents;
+    EventStream secondEvents;
+    std::string firstResults = Run(first, firstEvents);
+    std::string secondResults = Run(second, secondEvents);
+    std::string difference = anyOrder ? firstEvents.Sort().Compare(secondEvents.Sort()) : firstEvents.Compare(secondEvents);
+    if (difference.empty() && firstResults != secondResults)
+        difference = firstResults + " against " + secondResults;
+
+    Check(name.c_str(), difference.empty(), difference);
+}
+
+/// <summary>
+/// Both fleet backends pick the same printers, so whole runs must match, including with printers of different speeds.
+/// </summary>
+void CheckFleetBackends() {
+    const SimulationEngine engines[] = { SimulationEngine::DiscreteEvent, SimulationEngine::RealTime };
+    const char* engineNames[] = { "DiscreteEvent", "RealTime" };
+    for (int engine = 0; engine < 2; engine++) {
+        for (bool mixedSpeeds : { false, true }) {
+            SimulationSettings heap = GetTestSettings();
+            heap.engine = engines[engine];
+            heap.fleetBackend = FleetBackend::Heap;
+            if (mixedSpeeds) {
+                heap.printerProfiles = MIXED_PROFILES;
+                heap.secondsPerJob = MIXED_SECONDS_PER_JOB;
+            }
+
+            SimulationSettings arrays = heap;
+            arrays.fleetBackend = FleetBackend::Arrays;
+            CheckSameRuns(std::string("Heap and Arrays log the same events under ") + engineNames[engine] + (mixedSpeeds ? " with mixed speeds" : ""),
+                heap, arrays);
+        }
+    }
+}
+
+/// <summary>
+/// Overloads the fleet and checks that no printer's queue and not the whole backlog ever went past the admission limits.  Each
+/// limit must also have turned jobs away, or the check proves nothing.
+/// </summary>
+void CheckAdmissionLimits() {
+    const SimulationEngine engines[] = { SimulationEngine::DiscreteEvent, SimulationEngine::RealTime, SimulationEngine::RealTimeThreaded };
+    const char* engineNames[] = { "DiscreteEvent", "RealTime", "RealTimeThreaded" };
+    for (int engine = 0; engine < 3; engine++) {
+        for (AdmissionPolicy policy : { AdmissionPolicy::Reject, AdmissionPolicy::Defer }) {
+            for (bool limitQueues : { true, false }) {
+                SimulationSettings settings = GetTestSettings();
+                settings.engine = engines[engine];
+                settings.workerThreads = LIMIT_WORKER_THREADS;
+                settings.secondsPerJob = OVERLOADED_SECONDS_PER_JOB;
+                settings.admissionPolicy = policy;
+                if (limitQueues) {
+                    settings.maxQueueLength = LIMIT_QUEUE_LENGTH;
+                }
+                else {
+                    settings.maxBacklogPages = LIMIT_BACKLOG_PAGES;
+                }
+
+                std::string name = std::string(limitQueues ? "MAX_QUEUE_LENGTH" : "MAX_BACKLOG_PAGES") + " holds with " +
+                    (policy == AdmissionPolicy::Reject ? "Reject" : "Defer") + " under " + engineNames[engine];
+                Simulation simulation;
+                if (!simulation.Setup(settings)) {
+                    Check(name.c_str(), false, "failed to set up");
+                    continue;
+                }
+
+                simulation.Run();
+                const FleetBacklog& backlog = simulation.GetBacklog();
+                long long turnedAway = policy == AdmissionPolicy::Reject ? simulation.GetRejectedJobs() : simulation.GetDeferredJobs();
+                size_t peakQueueLength = backlog.PeakQueueLength();
+                long long peakPages = backlog.PeakPages();
+                bool withinLimit = limitQueues ? peakQueueLength <= LIMIT_QUEUE_LENGTH : peakPages <= LIMIT_BACKLOG_PAGES;
+                Check(name.c_str(), withinLimit && turnedAway > 0, "peak of " + std::to_string(peakQueueLength) + " jobs on a printer, " +
+                    std::to_string(peakPages) + " pages, " + std::to_string(turnedAway) + " jobs turned away");
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Stops runs halfway, saves a checkpoint, and carries on from it in a new simulation.  The two halves must log the same events as
+/// a run that never stopped and end with the same results.
+/// </summary>
+void CheckCheckpoints() {
+    const char* caseNames[] = { "", " with Defer", " with split jobs and work stealing", " with failing printers" };
+    for (int testCase = 0; testCase < 4; testCase++) {
+        SimulationSettings settings = GetTestSettings();
+        if (testCase == 1) {
+            settings.secondsPerJob = OVERLOADED_SECONDS_PER_JOB;
+            settings.admissionPolicy = AdmissionPolicy::Defer;
+            settings.maxQueueLength = LIMIT_QUEUE_LENGTH;
+        }
+        else if (testCase == 2) {
+            settings.splitPages = 20;
+            settings.workStealing = true;
+            settings.queueDiscipline = QueueDiscipline::WeightedFair;
+            settings.priorityClasses = 3;
+        }
+        else if (testCase == 3) {
+            settings.printerProfiles = { { 20 }, { 30, 5000, 3000, 0.3 } };
+        }
+
+        EventStream fullEvents;
+        std::string fullResults = Run(settings, fullEvents);
+
+        EventStream halfEvents;
+        EventStream restoredEvents;
+        CheckpointWriter checkpoint;
+        settings.secondsToSimulate = TEST_SECONDS_TO_SIMULATE / 2;
+        std::string halfResults = Run(settings, halfEvents, nullptr, &checkpoint);
+        std::string restoredResults = Run(settings, restoredEvents, &checkpoint);
+        halfEvents.records.insert(halfEvents.records.end(), restoredEvents.records.begin(), restoredEvents.records.end());
+
+        std::string difference = fullEvents.Compare(halfEvents);
+        if (halfResults.find("failed") == 0)
+            difference = halfResults;
+        else if (difference.empty() && fullResults != restoredResults)
+            difference = fullResults + " against " + restoredResults;
+
+        Check((std::string("A run carried on from a checkpoint matches one that never stopped") + caseNames[testCase]).c_str(), difference.empty(),
+            difference);
+    }
+}
+
+/// <summary>
+/// Checks the engines agree at the same seed.  One shard is the same as DiscreteEvent, since there is no other shard to send jobs to.
+/// RealTime starts jobs on whole simulated seconds, so only the jobs it creates match DiscreteEvent.  The results of more shards only
+/// depend on the settings, so two runs must do the same things however their threads happened to run, though the shards can log
+/// them in a different order.
+/// </summary>
+void CheckEngines() {
+    SimulationSettings discreteEvent = GetTestSettings();
+    SimulationSettings oneShard = discreteEvent;
+    oneShard.engine = SimulationEngine::Sharded;
+    oneShard.shards = 1;
+    CheckSameRuns("Sharded with one shard logs the same events as DiscreteEvent", discreteEvent, oneShard);
+
+    SimulationSettings realTime = discreteEvent;
+    realTime.engine = SimulationEngine::RealTime;
+    EventStream discreteEventEvents;
+    EventStream realTimeEvents;
+    Run(discreteEvent, discreteEventEvents);
+    Run(realTime, realTimeEvents);
+    std::string difference = discreteEventEvents.Filter(LogRecordType::JobCreated).Compare(realTimeEvents.Filter(LogRecordType::JobCreated));
+    Check("RealTime creates the same jobs as DiscreteEvent", difference.empty(), difference);
+
+    SimulationSettings shards = oneShard;
+    shards.printers = TEST_SHARDED_PRINTERS;
+    shards.shards = TEST_SHARDS;
+    shards.migrationPages = TEST_MIGRATION_PAGES;
+    shards.secondsPerJob = TEST_SECONDS_PER_JOB * TEST_PRINTERS / TEST_SHARDED_PRINTERS;
+    CheckSameRuns("Sharded runs with the same settings log the same events", shards, shards, true);
+    EventStream shardedEvents;
+    Run(shards, shardedEvents);
+    size_t migrated = shardedEvents.Filter(LogRecordType::JobMigrated).records.size();
+    Check("Sharded runs send jobs to other shards", migrated > 0, "no jobs were sent");
+}
+
+int main() {
+    CheckDispatchIndex();
+    CheckFleetBackends();
+    CheckAdmissionLimits();
+    CheckCheckpoints();
+    CheckEngines();
+    return failedChecks;
+}
@@ -0,0 +1,103 @@
+/*
+Description - Alias table (Vose's alias method) for sampling from a discrete distribution with any number of values in O(1).
+    The table is built once in O(N), and each sample then takes a single random number.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Random.h"
+
+class AliasTable {
+    std::vector<int> values;
+    std::vector<std::uint32_t> thresholds;//Chance of keeping a column's own value instead of its alias, out of 2^32
+    std::vector<int> aliases;
+public:
+    AliasTable() {}
+
+    AliasTable(const std::vector<int>& values, const std::vector<double>& weights) {
+        Build(values, weights);
+    }
+
+    /// <summary>
+    /// Builds the table so that each value is sampled in proportion to its weight.  Values with a weight of 0 or less are left out.
+    /// </summary>
+    void Build(const std::vector<int>& tableValues, const std::vector<double>& weights) {
+        values.clear();
+        std::vector<double> scaled;
+        double totalWeight = 0;
+        for (size_t i = 0; i < tableValues.size(); i++) {
+            if (weights[i] <= 0)
+                continue;
+
+            values.push_back(tableValues[i]);
+            scaled.push_back(weights[i]);
+            totalWeight += weights[i];
+        }
+
+        size_t count = values.size();
+        thresholds.assign(count, 0xFFFFFFFFu);
+        aliases.resize(count);
+
+        //Scale the weights so the average column is 1, then fill each column that is short with part of one that is over
+        std::vector<int> small;
+        std::vector<int> large;
+        for (size_t i = 0; i < count; i++) {
+            aliases[i] = static_cast<int>(i);
+            scaled[i] = scaled[i] * count / totalWeight;
+            if (scaled[i] < 1) {
+                small.push_back(static_cast<int>(i));
+            }
+            else {
+                large.push_back(static_cast<int>(i));
+            }
+        }
+
+        while (small.size() > 0 && large.size() > 0) {
+            int shortColumn = small.back();
+            small.pop_back();
+            int tallColumn = large.back();
+            thresholds[shortColumn] = static_cast<std::uint32_t>(scaled[shortColumn] * 4294967296.0);
+            aliases[shortColumn] = tallColumn;
+            scaled[tallColumn] -= 1 - scaled[shortColumn];
+            if (scaled[tallColumn] < 1) {
+                large.pop_back();
+                small.push_back(tallColumn);
+            }
+        }
+
+        //Anything left over is 1 except for rounding errors, so it always keeps its own value
+        for (int column : small) {
+            thresholds[column] = 0xFFFFFFFFu;
+            aliases[column] = column;
+        }
+
+        for (int column : large) {
+            thresholds[column] = 0xFFFFFFFFu;
+            aliases[column] = column;
+        }
+    }
+
+    size_t Size() const {
+        return values.size();
+    }
+
+    int Sample(Random& random) const {
+        std::uint64_t r = random.Next64();
+        size_t column = static_cast<size_t>(((r >> 32) * values.size()) >> 32);
+        std::uint32_t coin = static_cast<std::uint32_t>(r);
+        return coin < thresholds[column] ? values[column] : values[aliases[column]];
+    }
+
+    /// <summary>
+    /// Fills output with count samples.
+    /// </summary>
+    void Sample(Random& random, int* output, size_t count) const {
+        for (size_t i = 0; i < count; i++) {
+            output[i] = Sample(random);
+        }
+    }
+};
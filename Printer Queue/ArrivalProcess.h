@@ -0,0 +1,148 @@
+/*
+Description - Arrival times of the random jobs.  Fixed creates a job every secondsPerJob seconds, Poisson has exponential gaps with
+    that mean, TimeOfDay is a Poisson process whose rate changes through the day, and Bursty is a Markov modulated Poisson process
+    that switches between the normal rate and bursts at a higher rate.  Each arrival costs one or two exponential samples, so every
+    pattern is cheap enough to schedule as events.  Replaying a trace (see JobTrace) takes the place of all of them.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "Random.h"
+
+enum class ArrivalPattern {
+    Fixed,
+    Poisson,
+    TimeOfDay,
+    Bursty
+};
+
+struct ArrivalSettings {
+    ArrivalPattern pattern = ArrivalPattern::Fixed;
+    //TimeOfDay only.  The rate of each period relative to 1 job per secondsPerJob, starting at the start of the simulation and
+    //repeating after the last one.  For example, 24 rates with ratePeriodSeconds of an hour are the rate at each hour of the day.
+    std::vector<double> rates;
+    int ratePeriodSeconds = 60 * 60;
+    //Bursty only.  Bursts create jobs burstRate times as often, and both the bursts and the time between them are exponential.
+    double burstRate = 5;
+    int meanSecondsBetweenBursts = 60 * 60;
+    int meanBurstSeconds = 5 * 60;
+};
+
+class ArrivalProcess {
+    ArrivalSettings settings;
+    double meanSecondsPerJob = 30;
+    std::chrono::high_resolution_clock::duration fixedGap{};//Fixed is kept in whole clock ticks so it never drifts
+    Random random;//Only used for the arrivals, so the jobs are the same with every pattern
+    bool inBurst = false;
+    double burstChange = 0;//Seconds after the start when the Bursty process starts or ends a burst
+public:
+    void Setup(const ArrivalSettings& arrivalSettings, double secondsPerJob, std::uint64_t seed, std::uint64_t stream) {
+        settings = arrivalSettings;
+        meanSecondsPerJob = secondsPerJob > 0 ? secondsPerJob : 1;
+        fixedGap = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(meanSecondsPerJob));
+        random.Seed(seed, stream);
+        settings.ratePeriodSeconds = settings.ratePeriodSeconds > 0 ? settings.ratePeriodSeconds : 1;
+
+        //A day without any jobs would never have a next arrival
+        bool anyRate = false;
+        for (double rate : settings.rates) {
+            if (rate > 0)
+                anyRate = true;
+        }
+
+        if (!anyRate)
+            settings.rates.assign(1, 1);
+
+        //Bursts that take no time would switch forever without an arrival
+        settings.burstRate = settings.burstRate > 0 ? settings.burstRate : 1;
+        settings.meanSecondsBetweenBursts = std::max(1, settings.meanSecondsBetweenBursts);
+        settings.meanBurstSeconds = std::max(1, settings.meanBurstSeconds);
+
+        inBurst = false;
+        burstChange = settings.pattern == ArrivalPattern::Bursty ? NextExponential(settings.meanSecondsBetweenBursts) : 0;
+    }
+
+    /// <param name="previous">Time from the start of the simulation to the last arrival.</param>
+    /// <returns>Time from the start of the simulation to the next arrival.</returns>
+    std::chrono::high_resolution_clock::duration Next(std::chrono::high_resolution_clock::duration previous) {
+        if (settings.pattern == ArrivalPattern::Fixed)
+            return previous + fixedGap;
+
+        double seconds = std::chrono::duration<double>(previous).count();
+        switch (settings.pattern) {
+        case ArrivalPattern::TimeOfDay:
+            seconds = NextTimeOfDay(seconds);
+            break;
+        case ArrivalPattern::Bursty:
+            seconds = NextBursty(seconds);
+            break;
+        default:
+            seconds += NextExponential(meanSecondsPerJob);
+            break;
+        }
+
+        std::chrono::high_resolution_clock::duration next = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(seconds));
+        return next > previous ? next : previous;
+    }
+
+    void Save(CheckpointWriter& writer) const {
+        random.Save(writer);
+        writer.Write(inBurst);
+        writer.Write(burstChange);
+    }
+
+    void Restore(CheckpointReader& reader) {
+        random.Restore(reader);
+        reader.Read(inBurst);
+        reader.Read(burstChange);
+    }
+
+private:
+    double NextExponential(double mean) {
+        return -std::log(1 - random.NextDouble()) * mean;
+    }
+
+    /// <summary>
+    /// Inverts the integrated rate, which is exact for a rate that is constant within each period.  Starting from the last arrival,
+    /// the periods' expected arrivals are used up until one of them holds enough for a single exponential sample.
+    /// </summary>
+    double NextTimeOfDay(double seconds) {
+        double expectedArrivals = NextExponential(1);
+        const double period = settings.ratePeriodSeconds;
+        while (true) {
+            long long periods = static_cast<long long>(std::floor(seconds / period));
+            double periodEnd = (periods + 1) * period;
+            double rate = settings.rates[periods % settings.rates.size()] / meanSecondsPerJob;
+            if (rate > 0 && expectedArrivals <= rate * (periodEnd - seconds))
+                return seconds + expectedArrivals / rate;
+
+            if (rate > 0)
+                expectedArrivals -= rate * (periodEnd - seconds);
+
+            seconds = periodEnd;
+        }
+    }
+
+    /// <summary>
+    /// Takes an exponential gap at the current rate.  If the burst starts or ends first, the gap is thrown away and a new one is taken
+    /// from then at the new rate, which is exact since the gaps have no memory.
+    /// </summary>
+    double NextBursty(double seconds) {
+        while (true) {
+            double gap = NextExponential(meanSecondsPerJob / (inBurst ? settings.burstRate : 1));
+            if (seconds + gap < burstChange)
+                return seconds + gap;
+
+            seconds = std::max(seconds, burstChange);
+            inBurst = !inBurst;
+            burstChange = seconds + NextExponential(inBurst ? settings.meanBurstSeconds : settings.meanSecondsBetweenBursts);
+        }
+    }
+};
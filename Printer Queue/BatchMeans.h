@@ -0,0 +1,115 @@
+/*
+Description - Batch means confidence interval for the mean of a steady state simulation.  Values such as job latencies are
+    correlated, since a job waits behind the jobs queued ahead of it, so their own spread says little about how accurate their mean
+    is.  Averaging consecutive values in batches that are long enough gives batch means that are close to independent, and the
+    spread of those gives the confidence interval instead.
+*/
+
+#pragma once
+
+#include <cmath>
+
+#include "Checkpoint.h"
+
+class BatchMeans {
+    int batchSize = 100;
+    int inBatch = 0;//Values in the batch being filled
+    double batchSum = 0;
+
+    //Running mean and sum of squared differences of the batch means (Welford)
+    long long batches = 0;
+    double mean = 0;
+    double squares = 0;
+public:
+    /// <param name="valuesPerBatch">Values averaged into each batch.</param>
+    void Reset(int valuesPerBatch) {
+        batchSize = valuesPerBatch > 0 ? valuesPerBatch : 1;
+        inBatch = 0;
+        batchSum = 0;
+        batches = 0;
+        mean = 0;
+        squares = 0;
+    }
+
+    /// <returns>True if the value finished a batch.</returns>
+    bool Record(double value) {
+        batchSum += value;
+        if (++inBatch < batchSize)
+            return false;
+
+        double batchMean = batchSum / batchSize;
+        inBatch = 0;
+        batchSum = 0;
+        batches++;
+        double difference = batchMean - mean;
+        mean += difference / batches;
+        squares += difference * (batchMean - mean);
+        return true;
+    }
+
+    /// <summary>
+    /// Finished batches.  The values in the batch being filled aren't counted by anything below.
+    /// </summary>
+    long long Batches() const {
+        return batches;
+    }
+
+    double Mean() const {
+        return mean;
+    }
+
+    /// <summary>
+    /// Half the width of the 95% confidence interval of the mean, from Student's t distribution.
+    /// </summary>
+    double HalfWidth() const {
+        if (batches < 2)
+            return HUGE_VAL;
+
+        return GetCriticalValue(batches - 1) * std::sqrt(squares / (batches - 1) / batches);
+    }
+
+    /// <returns>True once there are at least minBatches and the confidence interval is within precision of the mean, such as 0.05
+    /// for ±5%.</returns>
+    bool IsPrecise(double precision, int minBatches) const {
+        return batches >= minBatches && batches >= 2 && HalfWidth() <= precision * std::fabs(mean);
+    }
+
+    void Save(CheckpointWriter& writer) const {
+        writer.Write(batchSize);
+        writer.Write(inBatch);
+        writer.Write(batchSum);
+        writer.Write(batches);
+        writer.Write(mean);
+        writer.Write(squares);
+    }
+
+    void Restore(CheckpointReader& reader) {
+        reader.Read(batchSize);
+        reader.Read(inBatch);
+        reader.Read(batchSum);
+        reader.Read(batches);
+        reader.Read(mean);
+        reader.Read(squares);
+        if (batchSize <= 0)
+            reader.Fail();
+    }
+
+private:
+    /// <summary>
+    /// The two sided 95% critical value of Student's t distribution.  Past 30 degrees of freedom, the value of the next smaller row
+    /// of a standard table is used, which only makes the interval slightly wider.
+    /// </summary>
+    static double GetCriticalValue(long long degreesOfFreedom) {
+        static const double criticalValues[] = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+        };
+
+        const long long tableSize = sizeof(criticalValues) / sizeof(criticalValues[0]);
+        if (degreesOfFreedom <= tableSize)
+            return criticalValues[degreesOfFreedom - 1];
+
+        return degreesOfFreedom < 40 ? 2.042 : degreesOfFreedom < 60 ? 2.021 : degreesOfFreedom < 120 ? 2.000 : 1.980;
+    }
+};
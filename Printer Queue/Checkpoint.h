@@ -0,0 +1,163 @@
+/*
+Description - Compact binary snapshots of a simulation.  Values are copied as their raw bytes in the order they are written, so
+    writing and reading a snapshot is little more than a memcpy, and a snapshot can be read straight out of a memory mapped file.
+    Snapshots are only meant to be read by the same build on the same platform, which the header checks.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// <summary>
+/// Checkpoints start with CHECKPOINT_MAGIC, then CHECKPOINT_BYTE_ORDER and the size of a pointer in the writer's layout, so a
+/// snapshot from a different platform is refused instead of read as garbage.
+/// </summary>
+const char CHECKPOINT_MAGIC[8] = { 'P', 'Q', 'S', 'N', 'A', 'P', '0', '4' };
+const std::uint32_t CHECKPOINT_BYTE_ORDER = 0x01020304;
+
+class CheckpointWriter {
+    std::vector<char> bytes;
+public:
+    CheckpointWriter() {
+        WriteArray(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        Write(CHECKPOINT_BYTE_ORDER);
+        Write(static_cast<std::uint32_t>(sizeof(void*)));
+    }
+
+    template <typename T>
+    void Write(const T& value) {
+        WriteArray(&value, 1);
+    }
+
+    template <typename T>
+    void WriteArray(const T* values, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written to a checkpoint");
+        const char* first = reinterpret_cast<const char*>(values);
+        bytes.insert(bytes.end(), first, first + sizeof(T) * count);
+    }
+
+    /// <summary>
+    /// Writes the number of values followed by the values.
+    /// </summary>
+    template <typename T>
+    void WriteVector(const std::vector<T>& values) {
+        Write(static_cast<std::uint64_t>(values.size()));
+        WriteArray(values.data(), values.size());
+    }
+
+    void WriteTime(std::chrono::high_resolution_clock::time_point time) {
+        Write(time.time_since_epoch().count());
+    }
+
+    void WriteDuration(std::chrono::high_resolution_clock::duration duration) {
+        Write(duration.count());
+    }
+
+    const std::vector<char>& Bytes() const {
+        return bytes;
+    }
+
+    /// <returns>False if the file couldn't be written.</returns>
+    bool Save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file);
+    }
+};
+
+/// <summary>
+/// Reads a snapshot written by CheckpointWriter.  The data isn't copied, so it must outlive the reader.  A read past the end or a
+/// bad count fails the reader, and every read after that does nothing, so the caller only needs to check Failed() once at the end.
+/// </summary>
+class CheckpointReader {
+    const char* data;
+    size_t size;
+    size_t position = 0;
+    bool failed = false;
+public:
+    CheckpointReader(const char* snapshot, size_t snapshotSize) : data(snapshot), size(snapshotSize) {
+        char magic[sizeof(CHECKPOINT_MAGIC)] = {};
+        std::uint32_t byteOrder = 0;
+        std::uint32_t pointerSize = 0;
+        ReadArray(magic, sizeof(magic));
+        Read(byteOrder);
+        Read(pointerSize);
+        if (std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || byteOrder != CHECKPOINT_BYTE_ORDER || pointerSize != sizeof(void*))
+            Fail();
+    }
+
+    template <typename T>
+    void Read(T& value) {
+        ReadArray(&value, 1);
+    }
+
+    template <typename T>
+    void ReadArray(T* values, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read from a checkpoint");
+        if (failed || count > (size - position) / sizeof(T)) {
+            Fail();
+            return;
+        }
+
+        std::memcpy(values, data + position, sizeof(T) * count);
+        position += sizeof(T) * count;
+    }
+
+    /// <summary>
+    /// Reads a count written before an array of values of elementSize bytes.  Fails if there aren't that many bytes left, so a
+    /// damaged count can't make the caller allocate a huge buffer.
+    /// </summary>
+    size_t ReadCount(size_t elementSize) {
+        std::uint64_t count = 0;
+        Read(count);
+        if (failed || count > (size - position) / (elementSize > 0 ? elementSize : 1)) {
+            Fail();
+            return 0;
+        }
+
+        return static_cast<size_t>(count);
+    }
+
+    template <typename T>
+    void ReadVector(std::vector<T>& values) {
+        values.resize(ReadCount(sizeof(T)));
+        ReadArray(values.data(), values.size());
+    }
+
+    void ReadTime(std::chrono::high_resolution_clock::time_point& time) {
+        std::chrono::high_resolution_clock::rep ticks = 0;
+        Read(ticks);
+        time = std::chrono::high_resolution_clock::time_point(std::chrono::high_resolution_clock::duration(ticks));
+    }
+
+    void ReadDuration(std::chrono::high_resolution_clock::duration& duration) {
+        std::chrono::high_resolution_clock::rep ticks = 0;
+        Read(ticks);
+        duration = std::chrono::high_resolution_clock::duration(ticks);
+    }
+
+    /// <summary>
+    /// Used by the reader's users when a value read doesn't fit what they are restoring into.
+    /// </summary>
+    void Fail() {
+        failed = true;
+        position = size;
+    }
+
+    bool Failed() const {
+        return failed;
+    }
+
+    bool AtEnd() const {
+        return position == size;
+    }
+};
@@ -0,0 +1,139 @@
+/*
+Description - Indexed min-heap used by the simulation to find the printer with the least pages left to print.
+*/
+
+#pragma once
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// Indexed min-heap of printers used to find the printer with the least pages left to print in O(log N).
+/// Printers are keyed by the time they will finish all of their jobs instead of by their pages left, because the finish time
+/// only changes when a job is added or completed while the pages left changes with every sheet printed.
+/// Ordering by finish time is the same as ordering by pages left, except that printers with the same number of pages left can
+/// have different finish times, so SelectLeastPagesLeft() checks all of the printers tied with the earliest one.
+/// </summary>
+class DispatchIndex {
+    std::vector<int> heap;//Printer IDs
+    std::vector<int> positions;//Position of each printer in the heap
+    std::vector<long long> keys;//Finish time of each printer, or NO_JOBS if it has nothing to print
+    std::vector<int> searchStack;//Reused by SelectLeastPagesLeft() to avoid allocating
+public:
+    static constexpr long long NO_JOBS = std::numeric_limits<long long>::min();
+
+    void Clear() {
+        heap.clear();
+        positions.clear();
+        keys.clear();
+    }
+
+    /// <summary>
+    /// Adds a printer with no jobs.  Printers must be added in order of their IDs.
+    /// </summary>
+    void Add() {
+        int printerID = static_cast<int>(keys.size());
+        keys.push_back(NO_JOBS);
+        positions.push_back(static_cast<int>(heap.size()));
+        heap.push_back(printerID);
+        SiftUp(positions[printerID]);
+    }
+
+    void Update(int printerID, long long finishTime) {
+        long long oldKey = keys[printerID];
+        keys[printerID] = finishTime;
+        if (finishTime < oldKey) {
+            SiftUp(positions[printerID]);
+        }
+        else {
+            SiftDown(positions[printerID]);
+        }
+    }
+
+    /// <summary>
+    /// Finds the printer that the old linear scan would have picked: the first printer with no jobs, otherwise the lowest
+    /// ID among the printers with the least pages left at the time now.  Times are in high_resolution_clock ticks.
+    /// </summary>
+    int SelectLeastPagesLeft(long long now, long long ticksPerSheet) {
+        int best = heap[0];
+        long long earliest = keys[best];
+        if (earliest == NO_JOBS)
+            return best;
+
+        //Every printer finishing within the same sheet as the earliest one has the same pages left
+        long long pagesLeft = (earliest - now + ticksPerSheet - 1) / ticksPerSheet;
+        long long latestTied = now + pagesLeft * ticksPerSheet;
+        searchStack.clear();
+        searchStack.push_back(0);
+        while (searchStack.size() > 0) {
+            int position = searchStack.back();
+            searchStack.pop_back();
+            int printerID = heap[position];
+            if (keys[printerID] > latestTied)
+                continue;
+
+            if (printerID < best)
+                best = printerID;
+
+            int child = position * 2 + 1;
+            if (child < heap.size())
+                searchStack.push_back(child);
+
+            if (child + 1 < heap.size())
+                searchStack.push_back(child + 1);
+        }
+
+        return best;
+    }
+
+    /// <returns>The first printer with no jobs, otherwise the printer that will finish all of its jobs first.</returns>
+    int SelectEarliestFinish() const {
+        return heap[0];
+    }
+
+private:
+    bool Less(int a, int b) {
+        if (keys[a] != keys[b])
+            return keys[a] < keys[b];
+
+        return a < b;
+    }
+
+    void Swap(int positionA, int positionB) {
+        std::swap(heap[positionA], heap[positionB]);
+        positions[heap[positionA]] = positionA;
+        positions[heap[positionB]] = positionB;
+    }
+
+    void SiftUp(int position) {
+        while (position > 0) {
+            int parent = (position - 1) / 2;
+            if (!Less(heap[position], heap[parent]))
+                break;
+
+            Swap(position, parent);
+            position = parent;
+        }
+    }
+
+    void SiftDown(int position) {
+        while (true) {
+            int smallest = position;
+            int left = position * 2 + 1;
+            int right = left + 1;
+            if (left < heap.size() && Less(heap[left], heap[smallest]))
+                smallest = left;
+
+            if (right < heap.size() && Less(heap[right], heap[smallest]))
+                smallest = right;
+
+            if (smallest == position)
+                break;
+
+            Swap(position, smallest);
+            position = smallest;
+        }
+    }
+};
+
@@ -0,0 +1,139 @@
+/*
+Description - Policies for choosing which printer gets a new job.  The simulation is compiled once for each policy, so choosing a
+    printer is an inlined call instead of a virtual one.  DispatchPolicy selects the policy at runtime.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// LeastPagesLeft sends each job to the printer with the least pages left to print.  Once printers have different speeds or can be
+/// down, this is the least time left to finish its jobs, counted in sheets at the standard speed.
+/// ShortestQueue sends each job to the printer with the fewest jobs.
+/// RoundRobin sends the jobs to each printer in turn.
+/// PowerOfTwoChoices picks two printers at random and sends the job to whichever will finish its jobs first.
+/// EarliestCompletion sends each job to the printer that would finish printing it first, counting the printer's speed.
+/// Ties always go to the printer with the lowest ID.
+/// </summary>
+enum class DispatchPolicy {
+    LeastPagesLeft,
+    ShortestQueue,
+    RoundRobin,
+    PowerOfTwoChoices,
+    EarliestCompletion
+};
+
+inline const char* GetDispatchPolicyName(DispatchPolicy policy) {
+    switch (policy) {
+    case DispatchPolicy::LeastPagesLeft:
+        return "Least Pages Left";
+    case DispatchPolicy::ShortestQueue:
+        return "Shortest Queue";
+    case DispatchPolicy::RoundRobin:
+        return "Round Robin";
+    case DispatchPolicy::PowerOfTwoChoices:
+        return "Power of Two Choices";
+    case DispatchPolicy::EarliestCompletion:
+        return "Earliest Completion";
+    }
+
+    return "Unknown";
+}
+
+//Each policy has Select(fleet, pages), which returns the ID of the printer for a new job with that many pages.  The fleet is the
+//Simulation, which provides PrinterCount(), GetQueueLength(), GetAvailableTime(), GetPrintTime(), HasUniformSpeeds(),
+//SelectLeastPagesLeft(), SelectEarliestFinish(), GetDispatchRandom(), and GetRoundRobinNext().  A new policy object is used for
+//each run, so policies keep any state they need in the fleet, where it is saved with a checkpoint.
+
+/// <summary>
+/// O(log N) with the Heap fleet backend.
+/// </summary>
+struct LeastPagesLeftPolicy {
+    template <typename Fleet>
+    int Select(Fleet& fleet, int) {
+        return fleet.SelectLeastPagesLeft();
+    }
+};
+
+/// <summary>
+/// O(N).
+/// </summary>
+struct ShortestQueuePolicy {
+    template <typename Fleet>
+    int Select(Fleet& fleet, int) {
+        int best = 0;
+        size_t shortest = fleet.GetQueueLength(0);
+        for (int i = 1; i < fleet.PrinterCount() && shortest > 0; i++) {
+            size_t length = fleet.GetQueueLength(i);
+            if (length < shortest) {
+                shortest = length;
+                best = i;
+            }
+        }
+
+        return best;
+    }
+};
+
+/// <summary>
+/// O(1).
+/// </summary>
+struct RoundRobinPolicy {
+    template <typename Fleet>
+    int Select(Fleet& fleet, int) {
+        int& next = fleet.GetRoundRobinNext();
+        int selected = next < fleet.PrinterCount() ? next : 0;
+        next = selected + 1 < fleet.PrinterCount() ? selected + 1 : 0;
+        return selected;
+    }
+};
+
+/// <summary>
+/// O(1).  Uses its own random numbers, so the jobs are the same as with the other policies.
+/// </summary>
+struct PowerOfTwoChoicesPolicy {
+    template <typename Fleet>
+    int Select(Fleet& fleet, int) {
+        int count = fleet.PrinterCount();
+        if (count == 1)
+            return 0;
+
+        int first = static_cast<int>(fleet.GetDispatchRandom().NextBelow(static_cast<std::uint32_t>(count)));
+        int second = static_cast<int>(fleet.GetDispatchRandom().NextBelow(static_cast<std::uint32_t>(count - 1)));
+        if (second >= first)
+            second++;
+
+        if (second < first) {
+            int lower = second;
+            second = first;
+            first = lower;
+        }
+
+        return fleet.GetAvailableTime(second) < fleet.GetAvailableTime(first) ? second : first;
+    }
+};
+
+/// <summary>
+/// When all printers print at the same speed, the job finishes first on the printer that finishes its current jobs first, which is
+/// O(1) with the Heap fleet backend.  Otherwise O(N).
+/// </summary>
+struct EarliestCompletionPolicy {
+    template <typename Fleet>
+    int Select(Fleet& fleet, int pages) {
+        if (fleet.HasUniformSpeeds())
+            return fleet.SelectEarliestFinish();
+
+        int best = 0;
+        auto earliest = fleet.GetAvailableTime(0) + fleet.GetPrintTime(0, pages);
+        for (int i = 1; i < fleet.PrinterCount(); i++) {
+            auto finish = fleet.GetAvailableTime(i) + fleet.GetPrintTime(i, pages);
+            if (finish < earliest) {
+                earliest = finish;
+                best = i;
+            }
+        }
+
+        return best;
+    }
+};
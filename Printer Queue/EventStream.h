@@ -0,0 +1,222 @@
+/*
+Description - Machine readable copy of the simulation's events for analytics.  EventWriter subscribes to the Logger and writes every
+    record it is handed to a file or pipe as compact binary records, CSV, or JSON Lines.  Records are formatted straight into one
+    large buffer that is written with a single call whenever it fills up, so writing the stream costs little more than the copy.
+
+    Binary streams start with EVENT_STREAM_MAGIC, CHECKPOINT_BYTE_ORDER as a uint32, and the size of a record as a uint32, followed
+    by records in the byte order of the writer:
+        int64 time (milliseconds since the clock's epoch), int32 printer, int32 job, int32 pages, uint8 type, 3 bytes of zeros
+    Printer and job are -1 when the event isn't about one.  Type is the LogRecordType value, in the order GetEventName() lists them.
+    CSV has a header row with the same columns, and JSON Lines has one object per event, with the type written as its name.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "Logger.h"
+#include "Simulation.h"
+
+enum class EventFormat {
+    Binary,
+    Csv,
+    JsonLines
+};
+
+const char EVENT_STREAM_MAGIC[8] = { 'P', 'Q', 'E', 'V', 'N', 'T', '0', '1' };
+const std::uint32_t EVENT_RECORD_BYTES = 24;
+
+inline const char* GetEventName(LogRecordType type) {
+    switch (type) {
+    case LogRecordType::JobCreated:
+        return "JobCreated";
+    case LogRecordType::JobQueued:
+        return "JobQueued";
+    case LogRecordType::JobStarted:
+        return "JobStarted";
+    case LogRecordType::JobFinished:
+        return "JobFinished";
+    case LogRecordType::JobRejected:
+        return "JobRejected";
+    case LogRecordType::JobDeferred:
+        return "JobDeferred";
+    case LogRecordType::JobShed:
+        return "JobShed";
+    case LogRecordType::JobSplit:
+        return "JobSplit";
+    case LogRecordType::JobPartsFinished:
+        return "JobPartsFinished";
+    case LogRecordType::JobStolen:
+        return "JobStolen";
+    case LogRecordType::PrinterStalled:
+        return "PrinterStalled";
+    case LogRecordType::PrinterOutage:
+        return "PrinterOutage";
+    case LogRecordType::PrinterRepaired:
+        return "PrinterRepaired";
+    case LogRecordType::JobMigrated:
+        return "JobMigrated";
+    default:
+        return "Separator";
+    }
+}
+
+class EventWriter {
+    static const size_t BUFFER_BYTES = 1 << 20;
+    static const size_t MAX_RECORD_BYTES = 128;
+
+    std::FILE* file = nullptr;
+    EventFormat format = EventFormat::Binary;
+    std::vector<char> buffer;
+    size_t used = 0;
+    bool failed = false;
+public:
+    EventWriter() : buffer(BUFFER_BYTES) {}
+
+    ~EventWriter() {
+        Close();
+    }
+
+    EventWriter(const EventWriter&) = delete;
+    EventWriter& operator=(const EventWriter&) = delete;
+
+    /// <summary>
+    /// Creates the file, or opens an existing pipe, and writes the header of the format.
+    /// </summary>
+    /// <returns>False if the file couldn't be opened.</returns>
+    bool Open(const std::string& path, EventFormat eventFormat) {
+        Close();
+        //Binary for every format, so lines end in \n on every platform
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+
+        //Only whole buffers are written, so the file's own buffer would just be another copy
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        format = eventFormat;
+        used = 0;
+        failed = false;
+        switch (format) {
+        case EventFormat::Binary: {
+            std::uint32_t recordBytes = EVENT_RECORD_BYTES;
+            Append(EVENT_STREAM_MAGIC, sizeof(EVENT_STREAM_MAGIC));
+            Append(&CHECKPOINT_BYTE_ORDER, sizeof(CHECKPOINT_BYTE_ORDER));
+            Append(&recordBytes, sizeof(recordBytes));
+            break;
+        }
+        case EventFormat::Csv: {
+            const char header[] = "time,event,printer,job,pages\n";
+            Append(header, sizeof(header) - 1);
+            break;
+        }
+        case EventFormat::JsonLines:
+            break;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Adds the records to the stream.  Separators are only for the console, so they are left out.
+    /// </summary>
+    void Write(const LogRecord* records, size_t count) {
+        if (file == nullptr)
+            return;
+
+        for (size_t i = 0; i < count; i++) {
+            const LogRecord& record = records[i];
+            if (record.type == LogRecordType::Separator)
+                continue;
+
+            if (BUFFER_BYTES - used < MAX_RECORD_BYTES)
+                Flush();
+
+            char* first = buffer.data() + used;
+            char* last = buffer.data() + BUFFER_BYTES;
+            char* end = first;
+            switch (format) {
+            case EventFormat::Binary:
+                end = FormatBinary(record, first);
+                break;
+            case EventFormat::Csv:
+                end = WriteNumber(end, last, record.time);
+                end = WriteText(end, last, ",");
+                end = WriteText(end, last, GetEventName(record.type));
+                end = WriteText(end, last, ",");
+                end = WriteNumber(end, last, record.printerID);
+                end = WriteText(end, last, ",");
+                end = WriteNumber(end, last, record.jobID);
+                end = WriteText(end, last, ",");
+                end = WriteNumber(end, last, record.pages);
+                end = WriteText(end, last, "\n");
+                break;
+            case EventFormat::JsonLines:
+                end = WriteText(end, last, "{\"time\":");
+                end = WriteNumber(end, last, record.time);
+                end = WriteText(end, last, ",\"event\":\"");
+                end = WriteText(end, last, GetEventName(record.type));
+                end = WriteText(end, last, "\",\"printer\":");
+                end = WriteNumber(end, last, record.printerID);
+                end = WriteText(end, last, ",\"job\":");
+                end = WriteNumber(end, last, record.jobID);
+                end = WriteText(end, last, ",\"pages\":");
+                end = WriteNumber(end, last, record.pages);
+                end = WriteText(end, last, "}\n");
+                break;
+            }
+
+            used += end - first;
+        }
+    }
+
+    /// <summary>
+    /// Used as the LogSubscriber, with the writer as the context.
+    /// </summary>
+    static void Subscriber(const LogRecord* records, size_t count, void* writer) {
+        static_cast<EventWriter*>(writer)->Write(records, count);
+    }
+
+    /// <summary>
+    /// Writes the rest of the buffer and closes the file.
+    /// </summary>
+    /// <returns>False if any of the stream couldn't be written.</returns>
+    bool Close() {
+        if (file == nullptr)
+            return !failed;
+
+        Flush();
+        if (std::fclose(file) != 0)
+            failed = true;
+
+        file = nullptr;
+        return !failed;
+    }
+
+private:
+    void Append(const void* data, size_t size) {
+        std::memcpy(buffer.data() + used, data, size);
+        used += size;
+    }
+
+    void Flush() {
+        if (used > 0 && std::fwrite(buffer.data(), 1, used, file) != used)
+            failed = true;
+
+        used = 0;
+    }
+
+    static char* FormatBinary(const LogRecord& record, char* first) {
+        std::int64_t time = record.time;
+        std::int32_t ids[3] = { record.printerID, record.jobID, record.pages };
+        std::memcpy(first, &time, sizeof(time));
+        std::memcpy(first + sizeof(time), ids, sizeof(ids));
+        first[20] = static_cast<char>(record.type);
+        first[21] = first[22] = first[23] = 0;
+        return first + EVENT_RECORD_BYTES;
+    }
+};
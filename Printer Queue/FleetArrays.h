@@ -0,0 +1,144 @@
+/*
+Description - Structure of arrays view of the printers used by the simulation to find the printer with the least pages left to print.
+    The finish time of every printer is kept in one contiguous array, so the whole fleet can be scanned with SIMD instructions
+    (AVX on x86, NEON on ARM64) instead of walking the Printer objects.
+    The AVX path is only compiled when __AVX__ is defined: the x64 configurations of the Visual Studio projects set
+    /arch:AVX (AdvancedVectorExtensions), and gcc/clang builds need -mavx or -march=native.  The Win32 configurations and
+    plain gcc/clang builds use the scalar loop.  ARM64 builds always get the NEON path.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FLEET_ARRAYS_AVX
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define FLEET_ARRAYS_NEON
+#endif
+
+/// <summary>
+/// Picks the same printer as DispatchIndex by computing the pages left of every printer from its finish time:
+/// pages left = ceil((finish time - now) / time per sheet).  Printers with no jobs have a finish time of NO_JOBS, which makes
+/// their pages left -infinity, so the first of them is always picked.  Times are high_resolution_clock ticks since the start of
+/// the simulation, which doubles hold exactly for over 100 days of nanosecond ticks.
+/// </summary>
+class FleetArrays {
+    std::vector<double> finishTimes;
+public:
+    static constexpr double NO_JOBS = -std::numeric_limits<double>::infinity();
+
+    void Clear() {
+        finishTimes.clear();
+    }
+
+    /// <summary>
+    /// Adds a printer with no jobs.  Printers must be added in order of their IDs.
+    /// </summary>
+    void Add() {
+        finishTimes.push_back(NO_JOBS);
+    }
+
+    void Update(int printerID, double finishTime) {
+        finishTimes[printerID] = finishTime;
+    }
+
+    /// <returns>The first printer with no jobs, otherwise the lowest ID among the printers with the least pages left at the time now.</returns>
+    int SelectLeastPagesLeft(double now, double ticksPerSheet) const {
+        const double* finish = finishTimes.data();
+        int count = static_cast<int>(finishTimes.size());
+        int i = 0;
+        double best = std::numeric_limits<double>::infinity();
+        int bestID = 0;
+
+#if defined(FLEET_ARRAYS_AVX)
+        if (count >= 4) {
+            //Each lane keeps the best printer among every 4th printer.  Comparing with < keeps the lowest ID in each lane.
+            __m256d nowVector = _mm256_set1_pd(now);
+            __m256d sheetVector = _mm256_set1_pd(ticksPerSheet);
+            __m256d bestVector = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+            __m256d bestIDs = _mm256_setzero_pd();
+            __m256d ids = _mm256_setr_pd(0, 1, 2, 3);
+            __m256d step = _mm256_set1_pd(4);
+            for (; i + 4 <= count; i += 4) {
+                __m256d pagesLeft = _mm256_ceil_pd(_mm256_div_pd(_mm256_sub_pd(_mm256_loadu_pd(finish + i), nowVector), sheetVector));
+                __m256d better = _mm256_cmp_pd(pagesLeft, bestVector, _CMP_LT_OQ);
+                bestVector = _mm256_blendv_pd(bestVector, pagesLeft, better);
+                bestIDs = _mm256_blendv_pd(bestIDs, ids, better);
+                ids = _mm256_add_pd(ids, step);
+            }
+
+            alignas(32) double lanes[4];
+            alignas(32) double laneIDs[4];
+            _mm256_store_pd(lanes, bestVector);
+            _mm256_store_pd(laneIDs, bestIDs);
+            ReduceLanes(lanes, laneIDs, 4, best, bestID);
+        }
+#elif defined(FLEET_ARRAYS_NEON)
+        if (count >= 2) {
+            float64x2_t nowVector = vdupq_n_f64(now);
+            float64x2_t sheetVector = vdupq_n_f64(ticksPerSheet);
+            float64x2_t bestVector = vdupq_n_f64(std::numeric_limits<double>::infinity());
+            float64x2_t bestIDs = vdupq_n_f64(0);
+            const double firstIDs[2] = { 0, 1 };
+            float64x2_t ids = vld1q_f64(firstIDs);
+            float64x2_t step = vdupq_n_f64(2);
+            for (; i + 2 <= count; i += 2) {
+                float64x2_t pagesLeft = vrndpq_f64(vdivq_f64(vsubq_f64(vld1q_f64(finish + i), nowVector), sheetVector));
+                uint64x2_t better = vcltq_f64(pagesLeft, bestVector);
+                bestVector = vbslq_f64(better, pagesLeft, bestVector);
+                bestIDs = vbslq_f64(better, ids, bestIDs);
+                ids = vaddq_f64(ids, step);
+            }
+
+            double lanes[2];
+            double laneIDs[2];
+            vst1q_f64(lanes, bestVector);
+            vst1q_f64(laneIDs, bestIDs);
+            ReduceLanes(lanes, laneIDs, 2, best, bestID);
+        }
+#endif
+
+        //Printers left over after the vector loop, or all of them without SIMD.  They have higher IDs, so ties keep the current best.
+        for (; i < count; i++) {
+            double pagesLeft = std::ceil((finish[i] - now) / ticksPerSheet);
+            if (pagesLeft < best) {
+                best = pagesLeft;
+                bestID = i;
+            }
+        }
+
+        return bestID;
+    }
+
+    /// <returns>The first printer with no jobs, otherwise the printer that will finish all of its jobs first.</returns>
+    int SelectEarliestFinish() const {
+        int bestID = 0;
+        for (int i = 1; i < finishTimes.size(); i++) {
+            if (finishTimes[i] < finishTimes[bestID])
+                bestID = i;
+        }
+
+        return bestID;
+    }
+
+private:
+    /// <summary>
+    /// Combines the best printer of each lane, preferring the lowest ID when they tie.
+    /// </summary>
+    static void ReduceLanes(const double* lanes, const double* laneIDs, int laneCount, double& best, int& bestID) {
+        best = lanes[0];
+        bestID = static_cast<int>(laneIDs[0]);
+        for (int lane = 1; lane < laneCount; lane++) {
+            int id = static_cast<int>(laneIDs[lane]);
+            if (lanes[lane] < best || (lanes[lane] == best && id < bestID)) {
+                best = lanes[lane];
+                bestID = id;
+            }
+        }
+    }
+};
@@ -0,0 +1,156 @@
+/*
+Description - Totals for a whole fleet of printers that are updated as jobs are queued, started, and finished, so the backlog of the
+    fleet can be read in O(1) instead of by checking every printer.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "Checkpoint.h"
+
+class FleetBacklog {
+    long long pages = 0;
+    int busyPrinters = 0;
+    std::vector<int> queueDepths;//Printers with each number of jobs in their queue.  The last is never 0 unless all printers have none.
+
+    //Highest backlog since the last ResetPeaks(), to see how deep bursts of jobs make the queues
+    long long peakPages = 0;
+    size_t peakQueueLength = 0;
+public:
+    void Clear(int printers) {
+        pages = 0;
+        busyPrinters = 0;
+        queueDepths.assign(1, printers);
+        peakPages = 0;
+        peakQueueLength = 0;
+    }
+
+    /// <param name="queueLength">Jobs in the printer's queue after adding the job.</param>
+    void JobQueued(int jobPages, size_t queueLength) {
+        pages += jobPages;
+        MovePrinter(queueLength - 1, queueLength);
+        if (pages > peakPages)
+            peakPages = pages;
+
+        if (queueLength > peakQueueLength)
+            peakQueueLength = queueLength;
+    }
+
+    void JobStarted() {
+        busyPrinters++;
+    }
+
+    /// <param name="queueLength">Jobs in the printer's queue after removing the job.</param>
+    void JobFinished(int jobPages, size_t queueLength) {
+        pages -= jobPages;
+        busyPrinters--;
+        MovePrinter(queueLength + 1, queueLength);
+    }
+
+    /// <summary>
+    /// A job that hadn't started was taken out of the printer's queue.
+    /// </summary>
+    /// <param name="queueLength">Jobs in the printer's queue after removing the job.</param>
+    void JobRemoved(int jobPages, size_t queueLength) {
+        pages -= jobPages;
+        MovePrinter(queueLength + 1, queueLength);
+    }
+
+    void Save(CheckpointWriter& writer) const {
+        writer.Write(pages);
+        writer.Write(busyPrinters);
+        writer.WriteVector(queueDepths);
+        writer.Write(peakPages);
+        writer.Write(peakQueueLength);
+    }
+
+    void Restore(CheckpointReader& reader) {
+        reader.Read(pages);
+        reader.Read(busyPrinters);
+        reader.ReadVector(queueDepths);
+        reader.Read(peakPages);
+        reader.Read(peakQueueLength);
+        if (queueDepths.empty())
+            reader.Fail();
+    }
+
+    /// <summary>
+    /// Pages of every job that is queued or printing.  The pages already printed of the current jobs are included, since they
+    /// change with time.  Use Printer::GetTotalPagesLeft() to subtract them for a single printer.
+    /// </summary>
+    long long Pages() const {
+        return pages;
+    }
+
+    int BusyPrinters() const {
+        return busyPrinters;
+    }
+
+    /// <returns>The number of printers with queueLength jobs queued or printing.</returns>
+    int PrintersWithQueueLength(size_t queueLength) const {
+        return queueLength < queueDepths.size() ? queueDepths[queueLength] : 0;
+    }
+
+    size_t MaxQueueLength() const {
+        return queueDepths.size() - 1;
+    }
+
+    long long PeakPages() const {
+        return peakPages;
+    }
+
+    /// <summary>
+    /// Most jobs queued or printing on one printer.
+    /// </summary>
+    size_t PeakQueueLength() const {
+        return peakQueueLength;
+    }
+
+    /// <summary>
+    /// Adds the backlog of another fleet, such as a shard of this one.  When each fleet peaked isn't known, so the peaks are the
+    /// highest of either instead of their sum.  RecordPeakPages() can raise the peak to totals of the fleets taken at the same time.
+    /// </summary>
+    void Merge(const FleetBacklog& other) {
+        pages += other.pages;
+        busyPrinters += other.busyPrinters;
+        if (other.queueDepths.size() > queueDepths.size())
+            queueDepths.resize(other.queueDepths.size(), 0);
+
+        for (size_t i = 0; i < other.queueDepths.size(); i++) {
+            queueDepths[i] += other.queueDepths[i];
+        }
+
+        peakPages = std::max(peakPages, other.peakPages);
+        peakQueueLength = std::max(peakQueueLength, other.peakQueueLength);
+    }
+
+    /// <summary>
+    /// Raises the peak to pages known to have been in the backlog at once, such as the merged fleets' total at some time.
+    /// </summary>
+    void RecordPeakPages(long long backlogPages) {
+        peakPages = std::max(peakPages, std::max(backlogPages, pages));
+    }
+
+    /// <summary>
+    /// Starts the peaks again from the current backlog, such as at the end of the warm up.
+    /// </summary>
+    void ResetPeaks() {
+        peakPages = pages;
+        peakQueueLength = MaxQueueLength();
+    }
+
+private:
+    void MovePrinter(size_t from, size_t to) {
+        if (to >= queueDepths.size())
+            queueDepths.resize(to + 1, 0);
+
+        queueDepths[from]--;
+        queueDepths[to]++;
+        while (queueDepths.size() > 1 && queueDepths.back() == 0) {
+            queueDepths.pop_back();
+        }
+    }
+};
@@ -0,0 +1,142 @@
+/*
+Description - Log-bucketed histogram (in the style of HdrHistogram) for recording times without storing every value.  Values are
+    counted in buckets that are 1 wide up to 2 * SUB_BUCKETS and then double in width with each power of 2, so any percentile is
+    within 1 / SUB_BUCKETS of the real value, and the memory used only grows with the log of the largest value.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Checkpoint.h"
+
+class Histogram {
+    static const int SUB_BUCKET_BITS = 7;
+    static const long long SUB_BUCKETS = 1LL << SUB_BUCKET_BITS;
+
+    std::vector<long long> counts;//Grows to fit the largest bucket used
+    long long count = 0;
+    long long sum = 0;
+    long long max = 0;
+public:
+    void Clear() {
+        counts.clear();
+        count = 0;
+        sum = 0;
+        max = 0;
+    }
+
+    /// <summary>
+    /// Counts a value.  Negative values are counted as 0.
+    /// </summary>
+    void Record(long long value) {
+        if (value < 0)
+            value = 0;
+
+        size_t bucket = GetBucket(value);
+        if (bucket >= counts.size())
+            counts.resize(bucket + 1, 0);
+
+        counts[bucket]++;
+        count++;
+        sum += value;
+        if (value > max)
+            max = value;
+    }
+
+    void Merge(const Histogram& other) {
+        if (other.counts.size() > counts.size())
+            counts.resize(other.counts.size(), 0);
+
+        for (size_t i = 0; i < other.counts.size(); i++) {
+            counts[i] += other.counts[i];
+        }
+
+        count += other.count;
+        sum += other.sum;
+        if (other.max > max)
+            max = other.max;
+    }
+
+    void Save(CheckpointWriter& writer) const {
+        writer.WriteVector(counts);
+        writer.Write(count);
+        writer.Write(sum);
+        writer.Write(max);
+    }
+
+    void Restore(CheckpointReader& reader) {
+        reader.ReadVector(counts);
+        reader.Read(count);
+        reader.Read(sum);
+        reader.Read(max);
+    }
+
+    long long Count() const {
+        return count;
+    }
+
+    long long Max() const {
+        return max;
+    }
+
+    double Mean() const {
+        return count > 0 ? static_cast<double>(sum) / count : 0;
+    }
+
+    /// <summary>
+    /// Uses the nearest rank, so the 99th percentile of 200 values is the 198th smallest.
+    /// </summary>
+    /// <param name="percentile">From 0 to 100.</param>
+    /// <returns>The largest value that could be in the bucket holding the percentile, but never more than the largest value recorded.</returns>
+    long long GetPercentile(double percentile) const {
+        if (count == 0)
+            return 0;
+
+        long long rank = static_cast<long long>(std::ceil(percentile / 100 * count));
+        if (rank < 1)
+            rank = 1;
+
+        long long seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                long long highest = GetBucketEnd(i) - 1;
+                return highest < max ? highest : max;
+            }
+        }
+
+        return max;
+    }
+
+private:
+    /// <summary>
+    /// Values below 2 * SUB_BUCKETS have their own bucket.  Above that, each power of 2 is split into SUB_BUCKETS buckets.
+    /// </summary>
+    static size_t GetBucket(long long value) {
+        if (value < SUB_BUCKETS * 2)
+            return static_cast<size_t>(value);
+
+        int exponent = 63;
+        while ((static_cast<std::uint64_t>(value) >> exponent) == 0) {
+            exponent--;
+        }
+
+        int shift = exponent - SUB_BUCKET_BITS;
+        long long subBucket = (value >> shift) - SUB_BUCKETS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + subBucket);
+    }
+
+    /// <returns>The smallest value above the bucket.</returns>
+    static long long GetBucketEnd(size_t bucket) {
+        long long index = static_cast<long long>(bucket);
+        if (index < SUB_BUCKETS * 2)
+            return index + 1;
+
+        int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+        long long subBucket = index % SUB_BUCKETS + SUB_BUCKETS;
+        return (subBucket + 1) << shift;
+    }
+};
@@ -0,0 +1,169 @@
+/*
+Description - Counters and timers for the hot paths of the simulation, used to see where the time of a tick goes without attaching a
+    profiler.  Compiled in by defining PRINTER_QUEUE_INSTRUMENTATION as 1 before including the simulation (or in the project's
+    preprocessor definitions).  When it is 0, the INSTRUMENT_ macros expand to nothing, so the simulation is the same as without them.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#ifndef PRINTER_QUEUE_INSTRUMENTATION
+#define PRINTER_QUEUE_INSTRUMENTATION 0
+#endif
+
+/// <summary>
+/// The parts of the simulation that are measured.  Times are inclusive, so a Dispatch inside an Update is counted in both.
+/// </summary>
+enum class Probe {
+    SimulationUpdate,
+    PrinterUpdate,
+    Dispatch,
+    Print,
+    Log,
+    Count
+};
+
+inline const char* GetProbeName(Probe probe) {
+    switch (probe) {
+    case Probe::SimulationUpdate:
+        return "Simulation::Update";
+    case Probe::PrinterUpdate:
+        return "Printer::Update";
+    case Probe::Dispatch:
+        return "Dispatch";
+    case Probe::Print:
+        return "Printer::Print";
+    case Probe::Log:
+        return "Log";
+    case Probe::Count:
+        break;
+    }
+
+    return "Unknown";
+}
+
+/// <summary>
+/// Every thread that hits a probe gets its own block of counters, so recording never locks or contends.  Only the owning thread
+/// writes a block, using plain loads and stores of relaxed atomics, so Dump() can read them from any thread at any time.  Blocks are
+/// kept in a lock-free list and never freed, so the counts of threads that have exited are still included.
+/// </summary>
+class Instrumentation {
+    struct ProbeCounters {
+        std::atomic<long long> calls{ 0 };
+        std::atomic<long long> nanoseconds{ 0 };
+        std::atomic<long long> maxNanoseconds{ 0 };
+    };
+
+    struct ThreadCounters {
+        ProbeCounters probes[static_cast<int>(Probe::Count)];
+        ThreadCounters* next = nullptr;
+    };
+
+    static std::atomic<ThreadCounters*>& Head() {
+        static std::atomic<ThreadCounters*> head{ nullptr };
+        return head;
+    }
+
+    static ThreadCounters& Local() {
+        static thread_local ThreadCounters* counters = Register();
+        return *counters;
+    }
+
+    static ThreadCounters* Register() {
+        ThreadCounters* counters = new ThreadCounters();
+        ThreadCounters* head = Head().load(std::memory_order_relaxed);
+        do {
+            counters->next = head;
+        } while (!Head().compare_exchange_weak(head, counters, std::memory_order_release, std::memory_order_relaxed));
+
+        return counters;
+    }
+
+    static void Add(std::atomic<long long>& counter, long long amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+public:
+    static bool IsEnabled() {
+        return PRINTER_QUEUE_INSTRUMENTATION != 0;
+    }
+
+    static void Record(Probe probe, long long nanoseconds) {
+        ProbeCounters& counters = Local().probes[static_cast<int>(probe)];
+        Add(counters.calls, 1);
+        Add(counters.nanoseconds, nanoseconds);
+        if (nanoseconds > counters.maxNanoseconds.load(std::memory_order_relaxed))
+            counters.maxNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Zeroes the counters of the calling thread.  Other threads' counters are only written by them, so they are left alone.
+    /// </summary>
+    static void ResetThread() {
+        ThreadCounters& counters = Local();
+        for (ProbeCounters& probe : counters.probes) {
+            probe.calls.store(0, std::memory_order_relaxed);
+            probe.nanoseconds.store(0, std::memory_order_relaxed);
+            probe.maxNanoseconds.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// <summary>
+    /// Prints the calls, total time, mean time, and longest time of each probe, summed over every thread.  Counts being written while
+    /// this runs may be missed until the next dump.
+    /// </summary>
+    static void Dump(std::ostream& out) {
+        if (!IsEnabled())
+            return;
+
+        out << "\nInstrumentation:\n";
+        out << "Probe                    Calls    Total (ms)   Mean (ns)    Max (ns)\n";
+        for (int i = 0; i < static_cast<int>(Probe::Count); i++) {
+            long long calls = 0;
+            long long nanoseconds = 0;
+            long long maxNanoseconds = 0;
+            for (ThreadCounters* counters = Head().load(std::memory_order_acquire); counters != nullptr; counters = counters->next) {
+                const ProbeCounters& probe = counters->probes[i];
+                calls += probe.calls.load(std::memory_order_relaxed);
+                nanoseconds += probe.nanoseconds.load(std::memory_order_relaxed);
+                long long threadMax = probe.maxNanoseconds.load(std::memory_order_relaxed);
+                if (threadMax > maxNanoseconds)
+                    maxNanoseconds = threadMax;
+            }
+
+            out << std::left << std::setw(20) << GetProbeName(static_cast<Probe>(i)) << std::right << std::setw(10) << calls
+                << std::fixed << std::setprecision(1) << std::setw(14) << nanoseconds / 1e6 << std::setw(12) << (calls > 0 ? static_cast<double>(nanoseconds) / calls : 0)
+                << std::setw(12) << maxNanoseconds << "\n";
+        }
+    }
+};
+
+/// <summary>
+/// Records the time from its construction to the end of its scope.
+/// </summary>
+class ScopedProbe {
+    Probe probe;
+    std::chrono::steady_clock::time_point start;
+public:
+    explicit ScopedProbe(Probe probe) : probe(probe), start(std::chrono::steady_clock::now()) {}
+
+    ScopedProbe(const ScopedProbe&) = delete;
+    ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+    ~ScopedProbe() {
+        Instrumentation::Record(probe, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+#define INSTRUMENT_CONCAT_INNER(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_INNER(a, b)
+
+//Counts a call and times the rest of the enclosing scope
+#if PRINTER_QUEUE_INSTRUMENTATION
+#define INSTRUMENT_SCOPE(probe) ScopedProbe INSTRUMENT_CONCAT(scopedProbe, __LINE__)(Probe::probe)
+#else
+#define INSTRUMENT_SCOPE(probe) ((void)0)
+#endif
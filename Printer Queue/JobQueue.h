@@ -0,0 +1,274 @@
+/*
+Description - Multi-level queue of the jobs waiting for a printer.  Each level is a RingQueue, and a bitmap of the levels that have
+    jobs finds the next level to serve with a single bit scan, so adding and removing a job is O(1) instead of sorting the queue.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Checkpoint.h"
+#include "RingQueue.h"
+
+/// <summary>
+/// The order a printer prints its waiting jobs in.  Job priorities, 0 being the most urgent, are used as their classes.
+/// Fifo prints the jobs in the order they were added.
+/// StrictPriority always prints the most urgent class first, in the order the jobs were added within a class.
+/// WeightedFair shares the printer between the classes with waiting jobs in proportion to their weights, by pages printed.
+/// Class c of n has a weight of n - c, so no class is starved.
+/// ShortestJobFirst prints the jobs with the fewest pages first, to within a factor of 2.  Jobs are bucketed by the power of 2 of
+/// their pages, and the jobs in a bucket are printed in the order they were added.
+/// A job that has started printing is never interrupted.
+/// </summary>
+enum class QueueDiscipline {
+    Fifo,
+    StrictPriority,
+    WeightedFair,
+    ShortestJobFirst
+};
+
+inline int LowestSetBit(std::uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+inline int HighestSetBit(std::uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(bits);
+#endif
+}
+
+/// <summary>
+/// Job must have Pages and Priority.
+/// </summary>
+template <typename Job>
+class JobQueue {
+    static constexpr long long WEIGHTED_FAIR_STRIDE = 1 << 20;
+
+    std::vector<RingQueue<Job>> levels;
+    std::uint64_t occupiedLevels = 0;//Bit i is set if level i has jobs
+    size_t count = 0;
+    QueueDiscipline discipline = QueueDiscipline::Fifo;
+    int priorityClasses = 1;
+
+    //WeightedFair.  Each level's pass grows by its job's pages divided by its weight when it is served, and the level with the
+    //lowest pass is served next.
+    std::vector<long long> passes;
+    long long virtualTime = 0;//Pass of the level served last
+public:
+    static constexpr int MAX_LEVELS = 64;
+
+    /// <summary>
+    /// Removes all jobs.  The levels keep their memory.
+    /// </summary>
+    /// <param name="classes">Number of priority classes, from 1 to MAX_LEVELS.  Priorities must be less than this.</param>
+    void Reset(QueueDiscipline queueDiscipline, int classes) {
+        discipline = queueDiscipline;
+        priorityClasses = classes;
+        int levelCount = 1;
+        switch (discipline) {
+        case QueueDiscipline::Fifo:
+            break;
+        case QueueDiscipline::StrictPriority:
+        case QueueDiscipline::WeightedFair:
+            levelCount = priorityClasses;
+            break;
+        case QueueDiscipline::ShortestJobFirst:
+            levelCount = 32;//Enough for every positive int
+            break;
+        }
+
+        levels.resize(levelCount);
+        for (RingQueue<Job>& level : levels) {
+            level.Clear();
+        }
+
+        passes.assign(levelCount, 0);
+        virtualTime = 0;
+        occupiedLevels = 0;
+        count = 0;
+    }
+
+    size_t Size() const {
+        return count;
+    }
+
+    bool Empty() const {
+        return count == 0;
+    }
+
+    void Push(const Job& job) {
+        int level = GetLevel(job);
+        if (levels[level].Empty()) {
+            occupiedLevels |= std::uint64_t(1) << level;
+            //A class that has been idle starts level with the others instead of catching up on the time it had no jobs
+            if (passes[level] < virtualTime)
+                passes[level] = virtualTime;
+        }
+
+        levels[level].Push(job);
+        count++;
+    }
+
+    /// <summary>
+    /// Removes the next job to print.  The queue must not be empty.
+    /// </summary>
+    Job Pop() {
+        int level = discipline == QueueDiscipline::WeightedFair ? GetLowestPassLevel() : LowestSetBit(occupiedLevels);
+        RingQueue<Job>& queue = levels[level];
+        Job job = queue.Front();
+        queue.Pop();
+        count--;
+        if (queue.Empty())
+            occupiedLevels &= ~(std::uint64_t(1) << level);
+
+        if (discipline == QueueDiscipline::WeightedFair) {
+            virtualTime = passes[level];
+            passes[level] += job.Pages * WEIGHTED_FAIR_STRIDE / (priorityClasses - level);
+        }
+
+        return job;
+    }
+
+    /// <summary>
+    /// Removes the newest job of the last level served, which is the job that would be printed last except with WeightedFair.
+    /// Used to give a job to another printer.  The queue must not be empty.
+    /// </summary>
+    Job PopBack() {
+        int level = HighestSetBit(occupiedLevels);
+        RingQueue<Job>& queue = levels[level];
+        Job job = queue.Back();
+        queue.PopBack();
+        count--;
+        if (queue.Empty())
+            occupiedLevels &= ~(std::uint64_t(1) << level);
+
+        return job;
+    }
+
+    /// <summary>
+    /// Job must be trivially copyable.
+    /// </summary>
+    void Save(CheckpointWriter& writer) const {
+        writer.Write(static_cast<std::uint64_t>(levels.size()));
+        for (const RingQueue<Job>& level : levels) {
+            level.Save(writer);
+        }
+
+        writer.Write(occupiedLevels);
+        writer.Write(static_cast<std::uint64_t>(count));
+        writer.WriteVector(passes);
+        writer.Write(virtualTime);
+    }
+
+    /// <summary>
+    /// The queue must have been Reset() with the discipline and classes it was saved with.  The bitmap and count are rebuilt from the
+    /// levels, and a job in a level it wouldn't have been pushed to fails the reader, so a damaged snapshot can't leave Pop() reading
+    /// an empty level.
+    /// </summary>
+    void Restore(CheckpointReader& reader) {
+        std::uint64_t levelCount = 0;
+        reader.Read(levelCount);
+        if (levelCount != levels.size()) {
+            reader.Fail();
+            return;
+        }
+
+        occupiedLevels = 0;
+        count = 0;
+        for (int level = 0; level < levels.size(); level++) {
+            RingQueue<Job>& queue = levels[level];
+            queue.Restore(reader);
+            for (size_t i = 0; i < queue.Size(); i++) {
+                if (GetLevel(queue[i]) != level)
+                    reader.Fail();
+            }
+
+            if (!queue.Empty())
+                occupiedLevels |= std::uint64_t(1) << level;
+
+            count += queue.Size();
+        }
+
+        std::uint64_t savedOccupied = 0;
+        std::uint64_t savedCount = 0;
+        reader.Read(savedOccupied);
+        reader.Read(savedCount);
+        reader.ReadVector(passes);
+        reader.Read(virtualTime);
+        if (savedOccupied != occupiedLevels || savedCount != count || passes.size() != levels.size())
+            reader.Fail();
+
+        //A failed reader can leave the levels half restored
+        if (reader.Failed()) {
+            for (RingQueue<Job>& queue : levels) {
+                queue.Clear();
+            }
+
+            passes.assign(levels.size(), 0);
+            occupiedLevels = 0;
+            count = 0;
+        }
+    }
+
+    int LevelCount() const {
+        return static_cast<int>(levels.size());
+    }
+
+    /// <summary>
+    /// The jobs waiting in a level, in the order they will be printed.  Lower levels are served first except with WeightedFair.
+    /// </summary>
+    const RingQueue<Job>& Level(int level) const {
+        return levels[level];
+    }
+
+private:
+    int GetLevel(const Job& job) const {
+        switch (discipline) {
+        case QueueDiscipline::Fifo:
+            return 0;
+        case QueueDiscipline::StrictPriority:
+        case QueueDiscipline::WeightedFair:
+            return job.Priority;
+        case QueueDiscipline::ShortestJobFirst: {
+            int level = 0;
+            while ((job.Pages >> (level + 1)) > 0) {
+                level++;
+            }
+
+            return level;
+        }
+        }
+
+        return 0;
+    }
+
+    /// <returns>The level with jobs with the lowest pass.  Ties go to the most urgent level.</returns>
+    int GetLowestPassLevel() const {
+        int best = LowestSetBit(occupiedLevels);
+        std::uint64_t remaining = occupiedLevels & (occupiedLevels - 1);
+        while (remaining != 0) {
+            int level = LowestSetBit(remaining);
+            if (passes[level] < passes[best])
+                best = level;
+
+            remaining &= remaining - 1;
+        }
+
+        return best;
+    }
+};
@@ -0,0 +1,336 @@
+/*
+Description - Reads a log of real print jobs so a simulation can replay it instead of creating random jobs.  Traces are either
+    CSV files, which are streamed a line at a time, or compact binary files, which are memory mapped.  Neither is loaded into
+    memory all at once, so traces with millions of jobs can be replayed.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// A job from a trace.
+/// </summary>
+struct TraceJob {
+    long long arrival;//Milliseconds.  Only the differences between arrivals matter, so any epoch can be used.
+    int pages;
+    int priority;
+};
+
+/// <summary>
+/// Read only view of a whole file in memory.  The operating system loads the pages of the file as they are read.
+/// </summary>
+class MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+public:
+    MappedFile() {}
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        Close();
+    }
+
+    bool Open(const std::string& path) {
+        Close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            Close();
+            return false;
+        }
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            Close();
+            return false;
+        }
+
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr) {
+            Close();
+            return false;
+        }
+
+        size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size == 0) {
+            close(file);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);//The mapping keeps the file open
+        if (view == MAP_FAILED)
+            return false;
+
+        madvise(view, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+        data = static_cast<const char*>(view);
+        size = static_cast<size_t>(status.st_size);
+#endif
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (data != nullptr)
+            UnmapViewOfFile(data);
+
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data != nullptr)
+            munmap(const_cast<char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    const char* Data() const {
+        return data;
+    }
+
+    size_t Size() const {
+        return size;
+    }
+};
+
+/// <summary>
+/// Binary traces start with BINARY_TRACE_MAGIC followed by BINARY_TRACE_RECORD_BYTES for each job: the arrival as a 64 bit
+/// integer, then the pages and the priority as 32 bit integers, all little endian.
+/// </summary>
+const char BINARY_TRACE_MAGIC[8] = { 'P', 'Q', 'T', 'R', 'A', 'C', 'E', '1' };
+const size_t BINARY_TRACE_RECORD_BYTES = 16;
+
+/// <summary>
+/// How far a JobTrace has read, so a restored checkpoint can carry on from the same job.
+/// </summary>
+struct TracePosition {
+    long long offset;//In the file, or -1 once a CSV trace has been read to the end
+    long long lastArrival;
+    bool started;
+};
+
+/// <summary>
+/// Reads the jobs in a trace in order.  Binary traces are detected by their magic number, anything else is read as CSV with
+/// one job per line: arrival,pages and optionally ,priority.  Blank lines, lines starting with #, and lines that don't start
+/// with a number (such as a header) are skipped, as are jobs without any pages.  Jobs must be in arrival order; a job that
+/// arrives before the one ahead of it is treated as arriving at the same time.
+/// </summary>
+class JobTrace {
+    MappedFile binary;
+    size_t position = 0;//Offset of the next record in the binary file
+    std::ifstream csv;
+    std::string line;//Reused by Next() to avoid allocating
+    long long lastArrival = 0;
+    bool started = false;
+public:
+    JobTrace() {}
+
+    JobTrace(const JobTrace&) = delete;
+    JobTrace& operator=(const JobTrace&) = delete;
+
+    /// <returns>False if the file couldn't be read.</returns>
+    bool Open(const std::string& path) {
+        Close();
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        char magic[sizeof(BINARY_TRACE_MAGIC)] = {};
+        file.read(magic, sizeof(magic));
+        file.close();
+        if (std::memcmp(magic, BINARY_TRACE_MAGIC, sizeof(magic)) == 0) {
+            position = sizeof(BINARY_TRACE_MAGIC);
+            return binary.Open(path);
+        }
+
+        csv.open(path);
+        return csv.is_open();
+    }
+
+    void Close() {
+        binary.Close();
+        if (csv.is_open())
+            csv.close();
+
+        csv.clear();
+        position = 0;
+        lastArrival = 0;
+        started = false;
+    }
+
+    bool IsOpen() const {
+        return binary.Data() != nullptr || csv.is_open();
+    }
+
+    /// <summary>
+    /// Reads the next job.
+    /// </summary>
+    /// <returns>False once there are no jobs left.</returns>
+    bool Next(TraceJob& job) {
+        while (binary.Data() != nullptr ? NextBinary(job) : NextCSV(job)) {
+            if (job.pages <= 0)
+                continue;
+
+            if (started && job.arrival < lastArrival)
+                job.arrival = lastArrival;
+
+            lastArrival = job.arrival;
+            started = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    TracePosition GetPosition() {
+        long long offset = static_cast<long long>(position);
+        if (binary.Data() == nullptr)
+            offset = csv.eof() ? -1 : static_cast<long long>(csv.tellg());
+
+        return { offset, lastArrival, started };
+    }
+
+    /// <summary>
+    /// Moves to a position from GetPosition() of the same file.
+    /// </summary>
+    /// <returns>False if the position isn't in the file.</returns>
+    bool SetPosition(const TracePosition& tracePosition) {
+        lastArrival = tracePosition.lastArrival;
+        started = tracePosition.started;
+        if (binary.Data() != nullptr) {
+            if (tracePosition.offset < static_cast<long long>(sizeof(BINARY_TRACE_MAGIC)) || static_cast<size_t>(tracePosition.offset) > binary.Size())
+                return false;
+
+            position = static_cast<size_t>(tracePosition.offset);
+            return true;
+        }
+
+        csv.clear();
+        if (tracePosition.offset < 0) {
+            csv.seekg(0, std::ios::end);
+        }
+        else {
+            csv.seekg(static_cast<std::streamoff>(tracePosition.offset));
+        }
+
+        return static_cast<bool>(csv);
+    }
+
+private:
+    static std::uint64_t ReadLittleEndian(const char* bytes, int count) {
+        std::uint64_t value = 0;
+        for (int i = count - 1; i >= 0; i--) {
+            value = (value << 8) | static_cast<unsigned char>(bytes[i]);
+        }
+
+        return value;
+    }
+
+    bool NextBinary(TraceJob& job) {
+        if (binary.Size() - position < BINARY_TRACE_RECORD_BYTES)
+            return false;
+
+        const char* record = binary.Data() + position;
+        position += BINARY_TRACE_RECORD_BYTES;
+        job.arrival = static_cast<long long>(ReadLittleEndian(record, 8));
+        job.pages = static_cast<int>(static_cast<std::uint32_t>(ReadLittleEndian(record + 8, 4)));
+        job.priority = static_cast<int>(static_cast<std::uint32_t>(ReadLittleEndian(record + 12, 4)));
+        return true;
+    }
+
+    bool NextCSV(TraceJob& job) {
+        while (std::getline(csv, line)) {
+            const char* text = line.c_str();
+            char* end;
+            long long arrival = std::strtoll(text, &end, 10);
+            if (end == text || *end != ',')
+                continue;
+
+            text = end + 1;
+            long pages = std::strtol(text, &end, 10);
+            if (end == text)
+                continue;
+
+            job.arrival = arrival;
+            job.pages = static_cast<int>(pages);
+            job.priority = *end == ',' ? static_cast<int>(std::strtol(end + 1, nullptr, 10)) : 0;
+            return true;
+        }
+
+        return false;
+    }
+};
+
+/// <summary>
+/// Converts a trace of either format into a binary trace so it can be memory mapped the next time it is replayed.
+/// </summary>
+/// <returns>False if either file couldn't be opened or the output couldn't be written.</returns>
+inline bool WriteBinaryTrace(const std::string& inputPath, const std::string& outputPath) {
+    JobTrace input;
+    if (!input.Open(inputPath))
+        return false;
+
+    std::ofstream output(outputPath, std::ios::binary);
+    if (!output)
+        return false;
+
+    output.write(BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC));
+    TraceJob job;
+    char record[BINARY_TRACE_RECORD_BYTES];
+    while (input.Next(job)) {
+        std::uint64_t values[3] = { static_cast<std::uint64_t>(job.arrival), static_cast<std::uint32_t>(job.pages), static_cast<std::uint32_t>(job.priority) };
+        int sizes[3] = { 8, 4, 4 };
+        char* bytes = record;
+        for (int i = 0; i < 3; i++) {
+            for (int b = 0; b < sizes[i]; b++) {
+                *bytes++ = static_cast<char>((values[i] >> (b * 8)) & 0xFF);
+            }
+        }
+
+        output.write(record, sizeof(record));
+    }
+
+    return static_cast<bool>(output);
+}
@@ -0,0 +1,140 @@
+/*
+Description - Formats log records into text on the logging thread.  The writers fill a caller's buffer instead of using streams, so
+    formatting a record never allocates.
+*/
+
+#pragma once
+
+#include <charconv>
+
+#include "Logger.h"
+#include "SimulationSettings.h"
+
+/// <summary>
+/// Splits a time in milliseconds since the clock's epoch into the hours, minutes, and seconds of the day.
+/// </summary>
+inline void GetTimeOfDay(long long milliseconds, int& hours, int& minutes, int& seconds) {
+    long long todayTime = milliseconds % MILLISECONDS_PER_DAY;
+    hours = todayTime / (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE * MINUTES_PER_HOUR);
+    todayTime -= hours * (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE * MINUTES_PER_HOUR);
+    minutes = todayTime / (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE);
+    todayTime -= minutes * (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE);
+    seconds = todayTime / MILLISECONDS_PER_SECOND;
+}
+
+/// <summary>
+/// Size of a buffer that can hold the text written by any of the formatting functions below.
+/// The formatting functions write into [first, last), return the end of the text, and don't add a null terminator.
+/// </summary>
+const int FORMAT_BUFFER_SIZE = 64;
+
+inline char* WriteText(char* first, char* last, const char* text) {
+    while (*text != '\0' && first < last) {
+        *first++ = *text++;
+    }
+
+    return first;
+}
+
+inline char* WriteNumber(char* first, char* last, long long number) {
+    return std::to_chars(first, last, number).ptr;
+}
+
+inline char* WriteTwoDigits(char* first, char* last, int number) {
+    if (number < 10 && first < last)
+        *first++ = '0';
+
+    return WriteNumber(first, last, number);
+}
+
+/// <summary>
+/// Writes a time in milliseconds since the clock's epoch in HH:MM:SS format.
+/// </summary>
+inline char* FormatTime(char* first, char* last, long long milliseconds) {
+    int hours, minutes, seconds;
+    GetTimeOfDay(milliseconds, hours, minutes, seconds);
+    first = WriteTwoDigits(first, last, hours);
+    first = WriteText(first, last, ":");
+    first = WriteTwoDigits(first, last, minutes);
+    first = WriteText(first, last, ":");
+    return WriteTwoDigits(first, last, seconds);
+}
+
+inline char* FormatJob(char* first, char* last, int jobID, int pages) {
+    first = WriteText(first, last, "Job ");
+    first = WriteNumber(first, last, jobID);
+    first = WriteText(first, last, " (");
+    first = WriteNumber(first, last, pages);
+    return WriteText(first, last, " Pages)");
+}
+
+inline char* FormatPrinterName(char* first, char* last, int printerID) {
+    first = WriteText(first, last, "Printer ");
+    return WriteNumber(first, last, printerID);
+}
+
+/// <summary>
+/// Formats a log record on the logging thread.
+/// </summary>
+inline char* FormatLogRecord(const LogRecord& record, char* first, char* last) {
+    if (record.type != LogRecordType::Separator) {
+        first = FormatTime(first, last, record.time);
+        switch (record.type) {
+        case LogRecordType::JobCreated:
+            first = WriteText(first, last, " created ");
+            break;
+        case LogRecordType::JobQueued:
+            first = WriteText(first, last, " ");
+            first = FormatPrinterName(first, last, record.printerID);
+            first = WriteText(first, last, " added job to the queue ");
+            break;
+        case LogRecordType::JobStarted:
+            first = WriteText(first, last, " ");
+            first = FormatPrinterName(first, last, record.printerID);
+            first = WriteText(first, last, " started printing ");
+            break;
+        case LogRecordType::JobFinished:
+            first = WriteText(first, last, " ");
+            first = FormatPrinterName(first, last, record.printerID);
+            first = WriteText(first, last, " finished printing ");
+            break;
+        case LogRecordType::JobRejected:
+            first = WriteText(first, last, " rejected ");
+            break;
+        case LogRecordType::JobDeferred:
+            first = WriteText(first, last, " deferred ");
+            break;
+        case LogRecordType::JobShed:
+            first = WriteText(first, last, " shed ");
+            break;
+        case LogRecordType::JobSplit:
+            first = WriteText(first, last, " split ");
+            break;
+        case LogRecordType::JobPartsFinished:
+            first = WriteText(first, last, " finished every part of ");
+            break;
+        case LogRecordType::JobStolen:
+            first = WriteText(first, last, " ");
+            first = FormatPrinterName(first, last, record.printerID);
+            first = WriteText(first, last, " stole ");
+            break;
+        case LogRecordType::JobMigrated:
+            first = WriteText(first, last, " sent to another shard ");
+            break;
+        case LogRecordType::PrinterStalled:
+        case LogRecordType::PrinterOutage:
+        case LogRecordType::PrinterRepaired:
+            //Not about a job
+            first = WriteText(first, last, " ");
+            first = FormatPrinterName(first, last, record.printerID);
+            first = WriteText(first, last, record.type == LogRecordType::PrinterStalled ? " stalled" : record.type == LogRecordType::PrinterOutage ? " went down" : " is back up");
+            return WriteText(first, last, "\n");
+        default:
+            break;
+        }
+
+        first = FormatJob(first, last, record.jobID, record.pages);
+    }
+
+    return WriteText(first, last, "\n");
+}
@@ -0,0 +1,189 @@
+/*
+Description - Asynchronous logger.  The simulation writes fixed size binary records into a lock-free ring buffer and a background
+    thread formats them and writes them to std::cout in large batches, so the simulation never waits on the console.  Other modules
+    can subscribe to the records, such as EventWriter (see EventStream.h), and are handed each batch of records on the same thread.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MpscQueue.h"
+
+/// <summary>
+/// Off writes nothing.  Summary only writes the status of the printers at the end of the simulation.  Events also writes every job event.
+/// </summary>
+enum class LogLevel {
+    Off,
+    Summary,
+    Events
+};
+
+enum class LogRecordType : unsigned char {
+    JobCreated,
+    JobQueued,
+    JobStarted,
+    JobFinished,
+    JobRejected,
+    JobDeferred,
+    JobShed,
+    JobSplit,
+    JobPartsFinished,
+    JobStolen,
+    PrinterStalled,
+    PrinterOutage,
+    PrinterRepaired,
+    JobMigrated,//Sent to another shard
+    Separator//Blank line between groups of events
+};
+
+/// <summary>
+/// A single log message.  Records are formatted into text on the logging thread.
+/// </summary>
+struct LogRecord {
+    long long time;//Simulated milliseconds since the clock's epoch
+    int printerID;
+    int jobID;
+    int pages;
+    LogRecordType type;
+};
+
+/// <summary>
+/// Writes the text for a record into [first, last) and returns the end of the text.
+/// </summary>
+typedef char* (*LogFormatter)(const LogRecord& record, char* first, char* last);
+
+/// <summary>
+/// Called on the logging thread with each batch of records.  The records are the logger's own buffer, so they are only valid during
+/// the call.  Every subscriber is handed the same buffer instead of a copy.
+/// </summary>
+typedef void (*LogSubscriber)(const LogRecord* records, size_t count, void* context);
+
+class Logger {
+    static const size_t CAPACITY = 1 << 16;
+    static const size_t BATCH_BYTES = 1 << 16;
+    static const size_t MAX_RECORD_BYTES = 256;
+    static const size_t BATCH_RECORDS = 4096;//Records handed to the subscribers at a time
+
+    MpscQueue<LogRecord> queue;//Popped by the logging thread
+    std::atomic<bool> stopping{ false };
+    std::thread thread;
+    LogLevel level = LogLevel::Off;
+    LogFormatter formatter = nullptr;
+    std::vector<std::pair<LogSubscriber, void*>> subscribers;
+    bool recording = false;
+public:
+    Logger() {
+        queue.Reset(CAPACITY);
+    }
+
+    ~Logger() {
+        Stop();
+    }
+
+    void Start(LogLevel logLevel, LogFormatter logFormatter) {
+        Stop();
+        level = logLevel;
+        formatter = logFormatter;
+        recording = level >= LogLevel::Events || !subscribers.empty();
+        if (!recording)
+            return;
+
+        queue.Reset(CAPACITY);
+        stopping.store(false, std::memory_order_relaxed);
+        thread = std::thread(&Logger::Run, this);
+    }
+
+    /// <summary>
+    /// Writes all records that have been logged and stops the logging thread.
+    /// </summary>
+    void Stop() {
+        if (!thread.joinable())
+            return;
+
+        stopping.store(true, std::memory_order_release);
+        thread.join();
+    }
+
+    /// <summary>
+    /// Hands every record logged after the next Start() to the subscriber, whatever the LogLevel.  Can't be called while running.
+    /// </summary>
+    void Subscribe(LogSubscriber subscriber, void* context) {
+        subscribers.push_back({ subscriber, context });
+    }
+
+    /// <returns>True if the console writes at this level.</returns>
+    bool IsEnabled(LogLevel logLevel) const {
+        return logLevel != LogLevel::Off && logLevel <= level;
+    }
+
+    /// <returns>True if records are written to the console or subscribers, so events need to be logged.</returns>
+    bool IsRecording() const {
+        return recording;
+    }
+
+    /// <summary>
+    /// Adds a record to the ring buffer.  Safe to call from multiple threads.  Waits for the logging thread if the buffer is full.
+    /// </summary>
+    void Log(const LogRecord& record) {
+        queue.Push(record);
+    }
+
+private:
+    /// <summary>
+    /// Logging thread.  Takes records out of the ring buffer in batches, hands each batch to the subscribers, and formats the records
+    /// into one large buffer that is written whenever it fills up or the ring buffer is empty.
+    /// </summary>
+    void Run() {
+        std::vector<char> buffer(BATCH_BYTES);
+        char* first = buffer.data();
+        char* last = first + BATCH_BYTES;
+        char* end = first;
+        std::vector<LogRecord> records(BATCH_RECORDS);
+        bool writeText = level >= LogLevel::Events && formatter != nullptr;
+        while (true) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            size_t count;
+            do {
+                count = 0;
+                while (count < BATCH_RECORDS && queue.TryPop(records[count])) {
+                    count++;
+                }
+
+                if (count == 0)
+                    break;
+
+                for (const std::pair<LogSubscriber, void*>& subscriber : subscribers) {
+                    subscriber.first(records.data(), count, subscriber.second);
+                }
+
+                for (size_t i = 0; writeText && i < count; i++) {
+                    if (static_cast<size_t>(last - end) < MAX_RECORD_BYTES) {
+                        std::cout.write(first, end - first);
+                        end = first;
+                    }
+
+                    end = formatter(records[i], end, last);
+                }
+            } while (count == BATCH_RECORDS);
+
+            if (end != first) {
+                std::cout.write(first, end - first);
+                std::cout.flush();
+                end = first;
+            }
+
+            //Records logged before stopping was set have all been written
+            if (stop)
+                break;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+};
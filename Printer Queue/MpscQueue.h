@@ -0,0 +1,126 @@
+/*
+Description - Bounded lock-free queue that any number of threads can push to and one thread pops from.  Used to hand jobs to the
+    worker threads and shards, and records to the logging thread (see Logger.h), without locking.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+template <typename T>
+class MpscQueue {
+    /// <summary>
+    /// Slot in the ring buffer.  The sequence tells producers and the consumer whose turn it is to use the slot.
+    /// </summary>
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t capacity = 0;//Must be a power of 2
+    alignas(64) std::atomic<size_t> enqueuePosition{ 0 };
+    alignas(64) size_t dequeuePosition = 0;//Only used by the consumer
+public:
+    MpscQueue() {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /// <summary>
+    /// Empties the queue and makes room for queueCapacity values, rounded up to a power of 2.  Must not be called while other
+    /// threads are using the queue.
+    /// </summary>
+    void Reset(size_t queueCapacity) {
+        size_t newCapacity = 2;
+        while (newCapacity < queueCapacity) {
+            newCapacity *= 2;
+        }
+
+        if (newCapacity != capacity) {
+            cells.reset(new Cell[newCapacity]);
+            capacity = newCapacity;
+        }
+
+        for (size_t i = 0; i < capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        enqueuePosition.store(0, std::memory_order_relaxed);
+        dequeuePosition = 0;
+    }
+
+    /// <summary>
+    /// Adds a value.  Safe to call from multiple threads.  Waits for the consumer if the queue is full.
+    /// </summary>
+    void Push(const T& value) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position & (capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else {
+                //Full, or another thread claimed the slot first
+                if (difference < 0)
+                    std::this_thread::yield();
+
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// Adds a value unless the queue is full.  Safe to call from multiple threads.  Lets a producer that is also a consumer empty
+    /// its own queue while it waits, so two threads sending to each other can't both wait on full queues.
+    /// </summary>
+    /// <returns>False if the queue is full.</returns>
+    bool TryPush(const T& value) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position & (capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// <summary>
+    /// Removes the oldest value.  Only the consumer thread can call this.
+    /// </summary>
+    /// <returns>False if the queue is empty.</returns>
+    bool TryPop(T& value) {
+        Cell& cell = cells[dequeuePosition & (capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+            return false;
+
+        value = cell.value;
+        cell.sequence.store(dequeuePosition + capacity, std::memory_order_release);
+        dequeuePosition++;
+        return true;
+    }
+};
@@ -2,316 +2,381 @@
 Author - Isaac Richards
 Date - 26SEP23
 Description - Program used to simulate jobs being prioritized to a group of printers based on the printer with the least number of pages left to print.
-    The Simulation settings, NUMBER_OF_PRINTERS, SIMULATION_SPEED, and SECONDS_TO_SIMULATE can be changed to alter the simulation.
+    The Simulation settings, NUMBER_OF_PRINTERS, SIMULATION_SPEED, SECONDS_TO_SIMULATE, SECONDS_PER_JOB, SIMULATION_ENGINE, DISPATCH_POLICY, ADMISSION_POLICY, QUEUE_DISCIPLINE, and LOG_LEVEL can be changed to alter the simulation.
+    Setting RUN_BATCH runs many simulations in parallel for every combination of the Batch settings and reports the results for each.
+    Setting ARRIVAL_PATTERN makes the jobs arrive at random, with a rate that changes through the day, or in bursts (see ArrivalProcess.h).
+    Setting WARM_UP_SECONDS leaves the start of the run out of the results, and TARGET_PRECISION stops a run once its mean latency is known well enough.
+    Setting EVENT_FILE writes every event as binary records, CSV, or JSON Lines for analysis (see EventStream.h).
+    Setting CHECKPOINT_FILE saves the whole simulation at the end of the run, and RESTORE_FILE carries on from a saved simulation.
+    Every setting can also be given in a config file or on the command line without rebuilding, such as
+    "Printer Queue" scenario.cfg --NUMBER_OF_PRINTERS=6 --seconds-per-job 15 (see Scenario.h and --help).
+    Defining PRINTER_QUEUE_INSTRUMENTATION as 1 times the hot paths of the simulation and prints the times with the final status (see Instrumentation.h).
 */
 
 #include <iostream>
-#include <queue>
-#include <string>
-#include <chrono>
-#include <sstream>
-#include <thread>
-#include <random>
 #include <vector>
+#include <algorithm>
 #include <iomanip>
+#include <ctime>
+#include <iterator>
+#include <string>
 
-//Constants
-const int MILLISECONDS_PER_SECOND = 1000;
-const int SECONDS_PER_MINUTE = 60;
-const int MINUTES_PER_HOUR = 60;
-const int HOURS_PER_DAY = 24;
-const int MILLISECONDS_PER_DAY = MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE * MINUTES_PER_HOUR * HOURS_PER_DAY;
-const int SHEETS_PER_MINUTE = 7;
-const int MILLISECONDS_PER_SHEET = MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE / SHEETS_PER_MINUTE;
+#include "EventStream.h"
+#include "Logger.h"
+#include "Scenario.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
 
 //Simulation Settings
 const int NUMBER_OF_PRINTERS = 4;
 const int SIMULATION_SPEED = 300;//Simulated seconds per real second
 const int SECONDS_TO_SIMULATE = SECONDS_PER_MINUTE * 30;//Run for 30 simulated minutes
+const double SECONDS_PER_JOB = 30;//A new job is created every 30 simulated seconds, or 30 on average for the random arrival patterns
+const ArrivalPattern ARRIVAL_PATTERN = ArrivalPattern::Fixed;
+//TimeOfDay only.  The rate of jobs in each ARRIVAL_RATE_SECONDS from the start, relative to one every SECONDS_PER_JOB.  For example,
+//{ 0.2, 3, 1.5, 1, 1.2, 0.8, 0.2, 0.1 } with hours starts quiet, peaks in the second hour, and slows down for the evening.
+const std::vector<double> ARRIVAL_RATES = {};
+const int ARRIVAL_RATE_SECONDS = SECONDS_PER_MINUTE * MINUTES_PER_HOUR;
+const double BURST_RATE = 5;//Bursty only.  Bursts create jobs this many times as often as SECONDS_PER_JOB.
+const int MEAN_SECONDS_BETWEEN_BURSTS = SECONDS_PER_MINUTE * MINUTES_PER_HOUR;
+const int MEAN_BURST_SECONDS = SECONDS_PER_MINUTE * 5;
+const SimulationEngine SIMULATION_ENGINE = SimulationEngine::RealTime;
+const ClockMode CLOCK_MODE = ClockMode::Paced;
+const FleetBackend FLEET_BACKEND = FleetBackend::Heap;
+const DispatchPolicy DISPATCH_POLICY = DispatchPolicy::LeastPagesLeft;
+const int WORKER_THREADS = 0;//RealTimeThreaded only.  0 uses one per hardware thread.
+const int SHARDS = 0;//Sharded only.  0 uses one per hardware thread.
+const int MIGRATION_SECONDS = 10;//Sharded only.  Time for a job to reach another shard.  Longer lets the shards run further apart.
+//Sharded only.  New jobs are sent to the least loaded shard when their own has this many more backlog pages per printer than it.
+//0 never sends jobs, so each shard only prints its own share of the jobs.
+const int MIGRATION_PAGES = 0;
+const AdmissionPolicy ADMISSION_POLICY = AdmissionPolicy::AcceptAll;//What happens to new jobs when a limit below is passed
+const long long MAX_BACKLOG_PAGES = 0;//Pages queued or printing on all printers.  0 is no limit.
+const int MAX_QUEUE_LENGTH = 0;//Jobs queued or printing on the printer chosen for a new job.  0 is no limit.
+const int SHED_PAGES = 50;//ShedLarge drops jobs with more pages than this
+const int MAX_DEFERRED_JOBS = 1000;//Defer rejects jobs once this many are waiting
+const QueueDiscipline QUEUE_DISCIPLINE = QueueDiscipline::Fifo;//Order each printer prints its waiting jobs in
+const int PRIORITY_CLASSES = 1;//Random jobs are spread evenly over the classes
+const int SPLIT_PAGES = 0;//Jobs with more pages are split into parts of at most this many pages on different printers.  0 never splits.
+const int MAX_SPLIT_PARTS = 4;
+const bool WORK_STEALING = false;//Printers that run out of jobs take waiting jobs from the most loaded printer
+//Speed, setup, and failures of each model of printer, used by the printers in turn (see PrinterProfile).  For example,
+//{ { 7 }, { 30, 5000 }, { 60, 10000, SECONDS_PER_MINUTE * 90, 0.1 } } is a mix of 7, 30 and 60 sheets per minute with the fastest
+//warming up for 10 seconds and failing every 90 minutes on average.  Empty makes every printer the standard 7 sheets per minute.
+const std::vector<PrinterProfile> PRINTER_PROFILES = {};
+const int WARM_UP_SECONDS = 0;//Results are only measured after this much of SECONDS_TO_SIMULATE, so the empty queues at the start don't bias them
+//Stop early once the 95% confidence interval of the mean latency is within this fraction of the mean, such as 0.05 for +/-5%.
+//0 always runs for SECONDS_TO_SIMULATE.  The interval is from the means of batches of LATENCY_BATCH_JOBS jobs.
+const double TARGET_PRECISION = 0;
+const int LATENCY_BATCH_JOBS = 100;
+const int MIN_LATENCY_BATCHES = 10;
+const LogLevel LOG_LEVEL = LogLevel::Events;
+const unsigned long long SEED = 0;//0 picks a seed from the clock.  Use the seed printed at the end of a run to replay it.
+const char* const JOB_SIZES_FILE = "";//Print log to take the job sizes from (see LoadJobSizes()).  Empty uses the built in job sizes.
+const char* const TRACE_FILE = "";//Job log to replay instead of creating random jobs (see JobTrace).  Empty creates random jobs.
+const char* const EVENT_FILE = "";//File or pipe to write every event to, whatever the LOG_LEVEL.  Empty doesn't write one.  Not used by batches.
+const EventFormat EVENT_FORMAT = EventFormat::Binary;
+const char* const CHECKPOINT_FILE = "";//Snapshot to write at the end of the run (see Simulation::SaveCheckpoint()).  Empty doesn't write one.
+//Snapshot to carry on from for another SECONDS_TO_SIMULATE.  The other settings can differ from the run that wrote it, as long as
+//the printers, priority classes, queue discipline, and trace are the same.  Empty starts a new simulation.
+const char* const RESTORE_FILE = "";
+
+//Batch Settings
+const bool RUN_BATCH = false;
+const int BATCH_RUNS = 100;//Runs of each configuration, each with a different random stream
+const int BATCH_THREADS = 0;//0 uses one thread per hardware thread
+const int BATCH_PRINTER_COUNTS[] = { 2, 3, 4, 5, 6 };
+const int BATCH_SECONDS_PER_JOB[] = { 15, 30, 60 };
+const DispatchPolicy BATCH_DISPATCH_POLICIES[] = { DispatchPolicy::LeastPagesLeft };
 
 /// <summary>
-/// Tracks the simulated time of the simulation.
+/// Writes log records to the console on a background thread.
 /// </summary>
-static std::chrono::high_resolution_clock::time_point simulatedTime;
+static Logger logger;
 
 /// <summary>
-/// Tracks the real time.  Used to update the simulated time.
+/// Job sizes loaded from JOB_SIZES_FILE.
 /// </summary>
-static std::chrono::high_resolution_clock::time_point realTime;
-
-/// <returns>The simulatedTime as a string in HH:MM:SS format.</returns>
-static std::string GetTime() {
-    auto duration = simulatedTime.time_since_epoch();
-    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-    long long todayTime = milliseconds % MILLISECONDS_PER_DAY;
-    int hours = todayTime / (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE * MINUTES_PER_HOUR);
-    todayTime -= hours * (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE * MINUTES_PER_HOUR);
-    int minutes = todayTime / (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE);
-    todayTime -= minutes * (MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE);
-    int seconds = todayTime / MILLISECONDS_PER_SECOND;
-    std::stringstream ss;
-    ss << std::setw(2) << std::setfill('0') << hours << ":" << std::setw(2) << std::setfill('0') << minutes << ":" << std::setw(2) << std::setfill('0') << seconds;
-
-    return ss.str();
+static AliasTable jobSizes;
+
+/// <returns>The Simulation settings above.  A SEED of 0 is left for main() to pick once the scenario has been read.</returns>
+SimulationSettings GetSimulationSettings() {
+    SimulationSettings settings;
+    settings.printers = NUMBER_OF_PRINTERS;
+    settings.simulationSpeed = SIMULATION_SPEED;
+    settings.secondsToSimulate = SECONDS_TO_SIMULATE;
+    settings.secondsPerJob = SECONDS_PER_JOB;
+    settings.arrivals.pattern = ARRIVAL_PATTERN;
+    settings.arrivals.rates = ARRIVAL_RATES;
+    settings.arrivals.ratePeriodSeconds = ARRIVAL_RATE_SECONDS;
+    settings.arrivals.burstRate = BURST_RATE;
+    settings.arrivals.meanSecondsBetweenBursts = MEAN_SECONDS_BETWEEN_BURSTS;
+    settings.arrivals.meanBurstSeconds = MEAN_BURST_SECONDS;
+    settings.engine = SIMULATION_ENGINE;
+    settings.clockMode = CLOCK_MODE;
+    settings.fleetBackend = FLEET_BACKEND;
+    settings.dispatchPolicy = DISPATCH_POLICY;
+    settings.workerThreads = WORKER_THREADS;
+    settings.shards = SHARDS;
+    settings.migrationSeconds = MIGRATION_SECONDS;
+    settings.migrationPages = MIGRATION_PAGES;
+    settings.admissionPolicy = ADMISSION_POLICY;
+    settings.maxBacklogPages = MAX_BACKLOG_PAGES;
+    settings.maxQueueLength = MAX_QUEUE_LENGTH;
+    settings.shedPages = SHED_PAGES;
+    settings.maxDeferredJobs = MAX_DEFERRED_JOBS;
+    settings.queueDiscipline = QUEUE_DISCIPLINE;
+    settings.priorityClasses = PRIORITY_CLASSES;
+    settings.splitPages = SPLIT_PAGES;
+    settings.maxSplitParts = MAX_SPLIT_PARTS;
+    settings.workStealing = WORK_STEALING;
+    settings.printerProfiles = PRINTER_PROFILES;
+    settings.warmUpSeconds = WARM_UP_SECONDS;
+    settings.targetPrecision = TARGET_PRECISION;
+    settings.latencyBatchJobs = LATENCY_BATCH_JOBS;
+    settings.minLatencyBatches = MIN_LATENCY_BATCHES;
+    settings.seed = SEED;
+    settings.traceFile = TRACE_FILE;
+    return settings;
 }
 
 /// <summary>
-/// Used to store information about print jobs sent to printers.
+/// All of the settings above, after a config file and the command line have replaced any of them.
 /// </summary>
-struct PrintJob {
-    int ID;
-    int Pages;
-    PrintJob(int pages) {
-        static int jobCount = 0;
-        ID = jobCount++;
-        Pages = pages;
-    }
-
-    std::string ToString() {
-		std::stringstream ss;
-		ss << "Job " << ID << " (" << Pages << " Pages)";
-		return ss.str();
-	}
+struct Options {
+    SimulationSettings simulation = GetSimulationSettings();
+    LogLevel logLevel = LOG_LEVEL;
+    std::string jobSizesFile = JOB_SIZES_FILE;
+    std::string eventFile = EVENT_FILE;
+    EventFormat eventFormat = EVENT_FORMAT;
+    std::string checkpointFile = CHECKPOINT_FILE;
+    std::string restoreFile = RESTORE_FILE;
+    bool runBatch = RUN_BATCH;
+    int batchRuns = BATCH_RUNS;
+    int batchThreads = BATCH_THREADS;
+    std::vector<int> batchPrinterCounts = std::vector<int>(std::begin(BATCH_PRINTER_COUNTS), std::end(BATCH_PRINTER_COUNTS));
+    std::vector<int> batchSecondsPerJob = std::vector<int>(std::begin(BATCH_SECONDS_PER_JOB), std::end(BATCH_SECONDS_PER_JOB));
+    std::vector<DispatchPolicy> batchDispatchPolicies = std::vector<DispatchPolicy>(std::begin(BATCH_DISPATCH_POLICIES), std::end(BATCH_DISPATCH_POLICIES));
 };
 
-class Printer {
-    std::chrono::high_resolution_clock::time_point start;
-    int pagesPrinted = 0;//Pages printed for the current job
-    int totalPagesRemaining = 0;//Tracks pages for all jobs in the queue, not just the current job
-    int printerID;
-    std::queue<PrintJob> printQueue;
-    bool printing = false;//Tracks if the printer is currently printing the first job in the queue
-public:
-    Printer() {
-        static int printerCount = 0;
-        printerID = printerCount++;
-    }
-
-    void Update() {
-        if (NoJobs())
-            return;
-
-        //Update pages printed
-        auto timeSinceStart = std::chrono::duration_cast<std::chrono::milliseconds>(simulatedTime - start);
-        pagesPrinted = timeSinceStart.count() / MILLISECONDS_PER_SHEET;
-        PrintJob& currentJob = printQueue.front();
-        if (pagesPrinted > currentJob.Pages)
-            pagesPrinted = currentJob.Pages;
-
-        //If the job is complete, remove it from the queue and start the next job
-        if (JobComplete()) {
-            std::cout << GetTime() << " " << Name() << " finished printing " << currentJob.ToString() << std::endl;
-            totalPagesRemaining -= currentJob.Pages;
-            printQueue.pop();
-            printing = false;
-            CheckStartNextJob();
-
-            std::cout << std::endl;
-        }
-    }
+/// <summary>
+/// Replaces the options that are set in the scenario.  Each key is the name of a setting above.
+/// </summary>
+/// <returns>False with scenario.Error() set if a value can't be read or is out of range.</returns>
+bool ReadOptions(const Scenario& scenario, Options& options) {
+    return ReadSimulationSettings(scenario, options.simulation)
+        && scenario.Get("LOG_LEVEL", options.logLevel, {
+            { "Off", LogLevel::Off },
+            { "Summary", LogLevel::Summary },
+            { "Events", LogLevel::Events } })
+        && scenario.Get("JOB_SIZES_FILE", options.jobSizesFile)
+        && scenario.Get("EVENT_FILE", options.eventFile)
+        && scenario.Get("EVENT_FORMAT", options.eventFormat, {
+            { "Binary", EventFormat::Binary },
+            { "Csv", EventFormat::Csv },
+            { "JsonLines", EventFormat::JsonLines } })
+        && scenario.Get("CHECKPOINT_FILE", options.checkpointFile)
+        && scenario.Get("RESTORE_FILE", options.restoreFile)
+        && scenario.Get("RUN_BATCH", options.runBatch)
+        && scenario.Get("BATCH_RUNS", options.batchRuns, 1)
+        && scenario.Get("BATCH_THREADS", options.batchThreads, 0)
+        && scenario.GetList("BATCH_PRINTER_COUNTS", options.batchPrinterCounts, 1)
+        && scenario.GetList("BATCH_SECONDS_PER_JOB", options.batchSecondsPerJob, 1)
+        && scenario.GetList("BATCH_DISPATCH_POLICIES", options.batchDispatchPolicies, GetDispatchPolicyNames());
+}
 
-    int PagesLeft() {
-        if (NoJobs())
-            return 0;
+void PrintUsage() {
+    std::cout << "Usage: \"Printer Queue\" [config file] [--KEY=value | --KEY value]...\n"
+        << "Config files have one KEY = value per line, and # starts a comment.  The command line overrides the config file, and both\n"
+        << "override the settings built into Printer Queue.cpp.  Keys ignore case, - and _.  Lists are separated by commas, and\n"
+        << "PRINTER_PROFILES are separated by semicolons, such as 7; 30, 5000; 60, 10000, 5400, 0.1.\n"
+        << "Simulation: NUMBER_OF_PRINTERS, SIMULATION_SPEED, SECONDS_TO_SIMULATE, SECONDS_PER_JOB, ARRIVAL_PATTERN, ARRIVAL_RATES,\n"
+        << "    ARRIVAL_RATE_SECONDS, BURST_RATE, MEAN_SECONDS_BETWEEN_BURSTS, MEAN_BURST_SECONDS, SIMULATION_ENGINE, CLOCK_MODE, FLEET_BACKEND,\n"
+        << "    DISPATCH_POLICY, WORKER_THREADS, SHARDS, MIGRATION_SECONDS, MIGRATION_PAGES, ADMISSION_POLICY, MAX_BACKLOG_PAGES,\n"
+        << "    MAX_QUEUE_LENGTH, SHED_PAGES, MAX_DEFERRED_JOBS, QUEUE_DISCIPLINE, PRIORITY_CLASSES, SPLIT_PAGES, MAX_SPLIT_PARTS, WORK_STEALING, SHEETS_PER_MINUTE,\n"
+        << "    PRINTER_PROFILES, WARM_UP_SECONDS, TARGET_PRECISION, LATENCY_BATCH_JOBS, MIN_LATENCY_BATCHES, SEED, STREAM, TRACE_FILE\n"
+        << "Output and files: LOG_LEVEL, EVENT_FILE, EVENT_FORMAT, JOB_SIZES_FILE, CHECKPOINT_FILE, RESTORE_FILE\n"
+        << "Batch: RUN_BATCH, BATCH_RUNS, BATCH_THREADS, BATCH_PRINTER_COUNTS, BATCH_SECONDS_PER_JOB, BATCH_DISPATCH_POLICIES\n";
+}
 
-        return printQueue.front().Pages - pagesPrinted;
-    }
+/// <summary>
+/// Results of a single simulation in a batch.
+/// </summary>
+struct RunResult {
+    Histogram queueWaits;
+    double utilization = 0;
+    double simulatedMinutes = 0;//Less than SECONDS_TO_SIMULATE if the run reached TARGET_PRECISION
+};
 
-    bool JobComplete() {
-        return PagesLeft() == 0;
-    }
+RunResult GetRunResult(Simulation& simulation, int warmUpSeconds) {
+    RunResult result;
+    result.queueWaits = simulation.GetQueueWaits();
+    result.utilization = simulation.GetUtilization();
+    result.simulatedMinutes = (std::chrono::duration<double>(simulation.GetMeasuredDuration()).count() + warmUpSeconds) / SECONDS_PER_MINUTE;
+    return result;
+}
 
-    bool IsIdle() {
-        return !printing;
+/// <summary>
+/// Runs BATCH_RUNS simulations of every combination of BATCH_PRINTER_COUNTS, BATCH_SECONDS_PER_JOB, and BATCH_DISPATCH_POLICIES on
+/// a thread pool using the DiscreteEvent engine, then prints the queue wait and printer utilization of each configuration.
+/// </summary>
+void RunBatch(const Options& options) {
+    const int batchRuns = options.batchRuns;
+    std::vector<SimulationSettings> configurations;
+    for (int printerCount : options.batchPrinterCounts) {
+        for (int secondsPerJob : options.batchSecondsPerJob) {
+            for (DispatchPolicy dispatchPolicy : options.batchDispatchPolicies) {
+                SimulationSettings configuration = options.simulation;
+                configuration.printers = printerCount;
+                configuration.secondsPerJob = secondsPerJob;
+                configuration.dispatchPolicy = dispatchPolicy;
+                configuration.engine = SimulationEngine::DiscreteEvent;
+                configurations.push_back(configuration);
+            }
+        }
     }
 
-    bool NoJobs() {
-        return printQueue.size() < 1;
-    }
+    //Each run writes to its own result, so the results don't need to be locked
+    std::vector<RunResult> results(configurations.size() * batchRuns);
+    unsigned long long seed = options.simulation.seed;
+    {
+        ThreadPool pool(options.batchThreads);
+        for (int i = 0; i < results.size(); i++) {
+            //Run r of every configuration uses stream r, so results don't depend on which thread does the run and the
+            //configurations are compared using the same jobs
+            SimulationSettings runSettings = configurations[i / batchRuns];
+            runSettings.seed = seed;
+            runSettings.stream = i % batchRuns;
+            RunResult* result = &results[i];
+            pool.Submit([runSettings, result] {
+                //Each worker thread reuses its own simulation for all of the runs it does
+                static thread_local Simulation simulation;
+                simulation.Setup(runSettings);
+                simulation.Run();
+                *result = GetRunResult(simulation, runSettings.warmUpSeconds);
+            });
+        }
 
-    void Print(PrintJob job) {
-        printQueue.push(job);
-        std::cout << GetTime() << " " << Name() << " added job to the queue " << job.ToString() << std::endl;
-        totalPagesRemaining += job.Pages;
-        if (printQueue.size() == 1)
-            CheckStartNextJob();
+        pool.Wait();
     }
 
-    void CheckStartNextJob() {
-        if (NoJobs())
-            return;
+    std::cout << batchRuns << " runs of each configuration, " << options.simulation.secondsToSimulate / SECONDS_PER_MINUTE << " simulated minutes each.  Seed: " << seed << "\n";
+    std::cout << "Printers  Seconds Per Job  Dispatch Policy         Started  Mean Wait (s)  P50 Wait (s)  P90 Wait (s)  P99 Wait (s)  Max Wait (s)  Utilization\n";
+    for (int c = 0; c < configurations.size(); c++) {
+        Histogram waits;
+        double utilization = 0;
+        for (int r = 0; r < batchRuns; r++) {
+            RunResult& result = results[c * batchRuns + r];
+            waits.Merge(result.queueWaits);
+            utilization += result.utilization;
+        }
 
-        if (!IsIdle())
-            return;
+        utilization /= batchRuns;
+        std::cout << std::setw(8) << configurations[c].printers << std::defaultfloat << std::setprecision(6) << std::setw(17) << configurations[c].secondsPerJob << "  "
+            << std::left << std::setw(20) << GetDispatchPolicyName(configurations[c].dispatchPolicy) << std::right << std::setw(10) << waits.Count()
+            << std::fixed << std::setprecision(1) << std::setw(15) << waits.Mean() / MILLISECONDS_PER_SECOND;
+        const double percentiles[] = { 50, 90, 99 };
+        for (double percentile : percentiles) {
+            std::cout << std::setw(14) << static_cast<double>(waits.GetPercentile(percentile)) / MILLISECONDS_PER_SECOND;
+        }
 
-        PrintJob currentJob = printQueue.front();
-        start = simulatedTime;
-        printing = true;
-        std::cout << GetTime() << " " << Name() << " started printing " << currentJob.ToString() << std::endl;
+        std::cout << std::setw(14) << static_cast<double>(waits.Max()) / MILLISECONDS_PER_SECOND << std::setw(12) << utilization * 100 << "%\n";
     }
 
-    int GetTotalPagesLeft() {
-        if (NoJobs())
-            return 0;
+    if (options.simulation.targetPrecision > 0) {
+        double simulatedMinutes = 0;
+        for (const RunResult& result : results) {
+            simulatedMinutes += result.simulatedMinutes;
+        }
 
-        return totalPagesRemaining - pagesPrinted;
+        std::cout << "Runs simulated a mean of " << simulatedMinutes / results.size() << " of the " << options.simulation.secondsToSimulate / SECONDS_PER_MINUTE
+            << " minutes, stopping once they reached TARGET_PRECISION\n";
     }
+}
 
-    std::string Name() {
-        std::stringstream ss;
-        ss << "Printer " << printerID;
-        return ss.str();
+int main(int argc, char* argv[]) {
+    Scenario scenario;
+    if (!scenario.ParseArguments(argc, argv)) {
+        std::cout << scenario.Error() << std::endl;
+        return 1;
     }
 
-    /// <summary>
-    /// Should only be called at the end of the simulation because it will clear the queue.
-    /// </summary>
-    void LogRemainingJobs() {
-        if (NoJobs()) {
-            std::cout << "No jobs remaining." << std::endl;
-			return;
-        }
-
-        bool first = true;
-        while (printQueue.size() > 0) {
-            PrintJob job = printQueue.front();
-            if (first) {
-				first = false;
-                std::cout << "Job " << job.ID << " (" << job.Pages << " Pages, " << job.Pages - pagesPrinted << " Remaining)";
-			}
-            else {
-                std::cout << ", " << job.ToString();
-			}
-
-			printQueue.pop();
-        }
+    if (scenario.Has("help")) {
+        PrintUsage();
+        return 0;
     }
-};
-
-static std::vector<Printer> printers;
 
-/// <summary>
-/// Creates a random number of pages for a print job.  Lower numbers of pages are more likely.
-/// </summary>
-int GetRandomPrintJob() {
-    int r = rand() % 10;
-    if (r <= 3)
-        return 1 + rand() % 10;//40% chance for 1-10 pages
+    Options options;
+    if (!ReadOptions(scenario, options)) {
+        std::cout << scenario.Error() << std::endl;
+        return 1;
+    }
 
-    if (r <= 6)
-        return 11 + rand() % 15;//30% chance for 11-25 pages
+    //Checked before anything runs, so a misspelled setting isn't silently left at its default
+    std::vector<std::string> unusedKeys = scenario.GetUnusedKeys();
+    if (!unusedKeys.empty()) {
+        std::cout << "Unknown setting " << unusedKeys[0] << ".  Run with --help for the settings." << std::endl;
+        return 1;
+    }
 
-    if (r <= 8)
-        return 26 + rand() % 25;//20% chance for 26-50 pages
+    SimulationSettings& settings = options.simulation;
+    if (settings.seed == 0)
+        settings.seed = static_cast<unsigned long long>(std::time(nullptr));
 
-    return 51 + rand() % 49;//10% chance for 51-100 pages
-}
+    if (!options.jobSizesFile.empty()) {
+        if (!LoadJobSizes(options.jobSizesFile, jobSizes)) {
+            std::cout << "Failed to load job sizes from " << options.jobSizesFile << std::endl;
+            return 1;
+        }
 
-void Update() {
-    //Update the printers pages printed and check if their current job is complete
-    for (int i = 0; i < printers.size(); i++) {
-        Printer& printer = printers[i];
-        printer.Update();
+        settings.jobSizes = &jobSizes;
     }
 
-    //Add a new job every 30 seconds
-    static auto nextJobTime = simulatedTime;
-    static auto timePerJob = std::chrono::seconds(30);
-    auto timeSinceLastJob = std::chrono::duration_cast<std::chrono::seconds>(simulatedTime - nextJobTime);
-    if (timeSinceLastJob >= timePerJob) {
-        nextJobTime += timePerJob;
-
-        //Create a new random print job
-        int jobSize = GetRandomPrintJob();
-        PrintJob job(jobSize);
-        std::cout << GetTime() << " created " << job.ToString() << std::endl;
-
-        //Find the printer with the least amount of pages left to print and add the job to that printer
-        int selectedForNewJob = 0;
-        for (int i = 0; i < printers.size(); i++) {
-            Printer& printer = printers[i];
-            if (printer.NoJobs()) {
-                selectedForNewJob = i;
-                break;
-            }
+    //Checked here so the batch runs don't each have to report it
+    if (!settings.traceFile.empty() && !JobTrace().Open(settings.traceFile)) {
+        std::cout << "Failed to open the trace " << settings.traceFile << std::endl;
+        return 1;
+    }
 
-            if (i == 0)
-                continue;
+    if (options.runBatch) {
+        RunBatch(options);
+        return 0;
+    }
 
-            Printer& selectedPrinter = printers[selectedForNewJob];
-            int selectedPrinterPagesLeft = selectedPrinter.GetTotalPagesLeft();
-            int printerPagesLeft = printer.GetTotalPagesLeft();
-            if (printerPagesLeft < selectedPrinterPagesLeft)
-                selectedForNewJob = i;
+    EventWriter events;
+    if (!options.eventFile.empty()) {
+        if (!events.Open(options.eventFile, options.eventFormat)) {
+            std::cout << "Failed to open the event file " << options.eventFile << std::endl;
+            return 1;
         }
 
-        //Add the job to the selected printer
-        Printer& selectedPrinter = printers[selectedForNewJob];
-        selectedPrinter.Print(job);
-        std::cout << std::endl;
+        logger.Subscribe(EventWriter::Subscriber, &events);
     }
-}
 
-/// <summary>
-/// Checks if 1 simulated second has passed since the last update.
-/// </summary>
-bool ShouldUpdate() {
-    static auto lastUpdate = std::chrono::high_resolution_clock::now();
-    long long timeSinceLastUpdate = std::chrono::duration_cast<std::chrono::milliseconds>(simulatedTime - lastUpdate).count();
-    //Update simulation once per simulated second.
-    if (timeSinceLastUpdate >= MILLISECONDS_PER_SECOND) {
-        lastUpdate += std::chrono::milliseconds(MILLISECONDS_PER_SECOND);
-        return true;
+    settings.logger = &logger;
+    logger.Start(options.logLevel, FormatLogRecord);
+    Simulation simulation;
+    if (!simulation.Setup(settings)) {
+        std::cout << "Failed to open the trace " << settings.traceFile << std::endl;
+        return 1;
     }
 
-    return false;
-}
-
-void Setup() {
-    //seed random number generator with current time
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
-
-    //Create printers
-    for (int i = 0; i < NUMBER_OF_PRINTERS; i++) {
-        printers.push_back(Printer());
+    if (!options.restoreFile.empty() && !simulation.RestoreCheckpoint(options.restoreFile)) {
+        std::cout << "Failed to restore the checkpoint " << options.restoreFile << std::endl;
+        return 1;
     }
 
-    simulatedTime = std::chrono::high_resolution_clock::now();
-    realTime = simulatedTime;
-}
-
-void Run() {
-    std::chrono::high_resolution_clock::time_point end = simulatedTime + std::chrono::seconds(SECONDS_TO_SIMULATE);
-    while (simulatedTime < end) {
-        //Update the simulated time
-        std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
-        long long timeSinceLastUpdate = std::chrono::duration_cast<std::chrono::microseconds>(now - realTime).count();
-        realTime += std::chrono::microseconds(timeSinceLastUpdate);
-        //Increase the simulated time by the amount of time that has passed since the last update multiplied by the simulation speed
-        simulatedTime += std::chrono::microseconds(timeSinceLastUpdate * SIMULATION_SPEED);
-        if (ShouldUpdate())
-            Update();
-
-        //Sleep
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	simulation.Run();
+	simulation.Cleanup();
+    if (!events.Close()) {
+        std::cout << "Failed to write the event file " << options.eventFile << std::endl;
+        return 1;
     }
-}
 
-void Cleanup() {
-    //Print the final status of the printers
-    std::cout << "\nSimulation ended at " << GetTime() << ".\nStatus of Printers:\n";
-    for (int i = 0; i < printers.size(); i++) {
-        Printer& printer = printers[i];
-        std::cout << printer.Name();
-        std::cout << " - Total pages left: " << printer.GetTotalPagesLeft() << ", ";
-        printer.LogRemainingJobs();
-        std::cout << std::endl;
+    if (!options.checkpointFile.empty() && !simulation.SaveCheckpoint(options.checkpointFile)) {
+        std::cout << "Failed to write the checkpoint " << options.checkpointFile << std::endl;
+        return 1;
     }
-}
 
-int main() {
-    Setup();
-	Run();
-	Cleanup();
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,353 @@
+/*
+Description - A printer and the print jobs it is sent.  A printer prints its current job and keeps the rest in its queue, and may
+    fail and be fixed while it is printing.  The members that use the printer's Simulation are defined at the end of Simulation.h,
+    since they need the whole Simulation class.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "Checkpoint.h"
+#include "JobQueue.h"
+#include "LogFormat.h"
+#include "Random.h"
+#include "SimulationSettings.h"
+#include "SpmcQueue.h"
+
+/// <summary>
+/// Used to store information about print jobs sent to printers.
+/// </summary>
+struct PrintJob {
+    int ID;
+    int Pages;
+    int Priority;//Class, 0 being the most urgent
+    int SplitSlot;//Slot of the split job this is a part of, or -1 if the job wasn't split
+    std::chrono::high_resolution_clock::time_point Created;
+    PrintJob() : ID(0), Pages(0), Priority(0), SplitSlot(-1) {}
+
+    PrintJob(int id, int pages, std::chrono::high_resolution_clock::time_point created, int priority = 0) {
+        ID = id;
+        Pages = pages;
+        Created = created;
+        Priority = priority;
+        SplitSlot = -1;
+    }
+
+    char* ToString(char* first, char* last) const {
+        return FormatJob(first, last, ID, Pages);
+    }
+};
+
+class Simulation;
+
+class Printer {
+    friend class Simulation;
+
+    Simulation* simulation;
+    std::chrono::high_resolution_clock::time_point start;
+    std::chrono::high_resolution_clock::duration paused{};//Time the current job has spent paused by failures
+    std::chrono::high_resolution_clock::duration busyTime{};//Time spent printing finished jobs
+    int totalPagesRemaining = 0;//Tracks pages for all jobs in the queue, not just the current job
+    int printerID;
+    int fleetID;//printerID in the whole fleet
+    PrintJob currentJob;
+    bool printing = false;//Tracks if the printer is currently printing currentJob.  A printer with jobs is printing one unless it is down.
+    JobQueue<PrintJob> waitingJobs;//Jobs that haven't started
+    char name[FORMAT_BUFFER_SIZE];//Cached because printerID never changes
+
+    PrinterProfile profile;
+    Random failureRandom;//Each printer has its own, so its failures are the same however the fleet is split between threads
+    int generation = 0;//Changes when the current job is paused, so its scheduled completion is ignored
+    bool down = false;
+    bool inOutage = false;//The current failure is an outage instead of a stall
+    std::chrono::high_resolution_clock::time_point downSince;
+    std::chrono::high_resolution_clock::time_point expectedUp;//From the mean time to fix the failure, which is all dispatch can know
+    std::chrono::high_resolution_clock::duration downTime{};//Of the failures that have been fixed
+    int stalls = 0;
+    int outages = 0;
+
+    /// <summary>
+    /// Used instead of waitingJobs by RealTimeThreaded printers when work stealing, so printers on other workers can take jobs.
+    /// </summary>
+    struct SharedJobs {
+        SpmcQueue<PrintJob> jobs;
+        std::atomic<int> stolenPages{ 0 };//Pages of the jobs taken by other printers, which are still in totalPagesRemaining
+        std::atomic<long long> currentFinish{ 0 };//simulatedTime ticks when the current job finishes
+    };
+
+    std::unique_ptr<SharedJobs> sharedJobs;
+public:
+    /// <param name="firstPrinterID">ID of the first printer in the simulation, which is only not 0 for a RealTimeThreaded worker.</param>
+    Printer(Simulation* simulation, int printerID, int firstPrinterID = 0) {
+        this->simulation = simulation;
+        this->printerID = printerID;
+        fleetID = firstPrinterID + printerID;
+        *FormatPrinterName(name, name + FORMAT_BUFFER_SIZE - 1, fleetID) = '\0';
+    }
+
+    /// <summary>
+    /// Removes all jobs and resets the printer for a new simulation.  The queue keeps its memory.
+    /// </summary>
+    /// <param name="shareJobs">Queue the jobs in sharedJobs.</param>
+    void Reset(const SimulationSettings& settings, bool shareJobs) {
+        busyTime = {};
+        totalPagesRemaining = 0;
+        waitingJobs.Reset(settings.queueDiscipline, settings.priorityClasses);
+        printing = false;
+        profile = settings.printerProfiles.empty() ? PrinterProfile() : settings.printerProfiles[fleetID % settings.printerProfiles.size()];
+        failureRandom.Seed(settings.seed, settings.stream | (1ULL << 60) | (static_cast<unsigned long long>(fleetID) << 32));
+        generation = 0;
+        down = false;
+        inOutage = false;
+        downTime = {};
+        stalls = 0;
+        outages = 0;
+        if (shareJobs) {
+            if (!sharedJobs)
+                sharedJobs.reset(new SharedJobs());
+
+            sharedJobs->jobs.Reset();
+            sharedJobs->stolenPages.store(0, std::memory_order_relaxed);
+            sharedJobs->currentFinish.store(0, std::memory_order_relaxed);
+        }
+        else {
+            sharedJobs.reset();
+        }
+    }
+
+    /// <summary>
+    /// Saves everything but the name.  The profile comes from the settings, and is only saved to tell if it has changed.
+    /// </summary>
+    void Save(CheckpointWriter& writer) const {
+        writer.Write(profile);
+        writer.WriteTime(start);
+        writer.WriteDuration(paused);
+        writer.WriteDuration(busyTime);
+        writer.Write(totalPagesRemaining);
+        writer.Write(currentJob);
+        writer.Write(printing);
+        waitingJobs.Save(writer);
+        failureRandom.Save(writer);
+        writer.Write(generation);
+        writer.Write(down);
+        writer.Write(inOutage);
+        writer.WriteTime(downSince);
+        writer.WriteTime(expectedUp);
+        writer.WriteDuration(downTime);
+        writer.Write(stalls);
+        writer.Write(outages);
+    }
+
+    /// <summary>
+    /// The printer must have been Reset() with settings that match the checkpoint, other than the profile.
+    /// </summary>
+    /// <param name="savedProfile">The profile when the checkpoint was written.  Retime() the printer if it isn't the profile now.</param>
+    void Restore(CheckpointReader& reader, PrinterProfile& savedProfile) {
+        reader.Read(savedProfile);
+        reader.ReadTime(start);
+        reader.ReadDuration(paused);
+        reader.ReadDuration(busyTime);
+        reader.Read(totalPagesRemaining);
+        reader.Read(currentJob);
+        reader.Read(printing);
+        waitingJobs.Restore(reader);
+        failureRandom.Restore(reader);
+        reader.Read(generation);
+        reader.Read(down);
+        reader.Read(inOutage);
+        reader.ReadTime(downSince);
+        reader.ReadTime(expectedUp);
+        reader.ReadDuration(downTime);
+        reader.Read(stalls);
+        reader.Read(outages);
+    }
+
+    void Update();
+
+    /// <summary>
+    /// Pages printed of the current job by the simulated time.  Worked out from when the job started, so it is always up to date.
+    /// </summary>
+    int GetPagesPrinted() const;
+
+    int PagesLeft() {
+        if (!printing)
+            return 0;
+
+        return currentJob.Pages - GetPagesPrinted();
+    }
+
+    bool JobComplete() {
+        return PagesLeft() == 0;
+    }
+
+    bool IsIdle() {
+        return !printing;
+    }
+
+    bool NoJobs() {
+        return GetQueueLength() == 0;
+    }
+
+    /// <summary>
+    /// The printer has no jobs and isn't down, so a new job would start straight away.
+    /// </summary>
+    bool IsAvailable() {
+        return NoJobs() && !down;
+    }
+
+    void Print(PrintJob job);
+
+    void CheckStartNextJob();
+
+    /// <summary>
+    /// Schedules the next failure, if the printer's profile has them.
+    /// </summary>
+    void ScheduleFailure();
+
+    /// <summary>
+    /// Stops the printer until its repair event.
+    /// </summary>
+    void Fail();
+
+    void Repair();
+
+    /// <summary>
+    /// Schedules the printer's events again with a new profile, once its events from the old profile have been removed.  The current
+    /// job is timed as if it had printed at the new speed since it started, and the time left until the next failure or until the
+    /// current failure is fixed is drawn again from the new means, which is exact since they have no memory.
+    /// </summary>
+    void Retime();
+
+    /// <summary>
+    /// Removes a job that hasn't started so another printer can print it.  The newest job of the last level served, or when the
+    /// jobs are shared, the oldest job.
+    /// </summary>
+    /// <returns>False if there are no waiting jobs, or another printer took the job first.</returns>
+    bool GiveAwayJob(PrintJob& job);
+
+    int GetTotalPagesLeft() {
+        if (NoJobs())
+            return 0;
+
+        return GetQueuedPages() - GetPagesPrinted();
+    }
+
+    /// <summary>
+    /// Time spent printing, including the current job.
+    /// </summary>
+    std::chrono::high_resolution_clock::duration GetBusyTime();
+
+    /// <summary>
+    /// Time spent down, including the current failure.
+    /// </summary>
+    std::chrono::high_resolution_clock::duration GetDownTime();
+
+    /// <summary>
+    /// Measures the time busy and down and the failures from the simulated time.
+    /// </summary>
+    void ResetMetrics() {
+        //Leaves the negative of the time so far of the current job and failure, so they only count from now
+        busyTime -= GetBusyTime();
+        downTime -= GetDownTime();
+        stalls = 0;
+        outages = 0;
+    }
+
+    int GetStalls() const {
+        return stalls;
+    }
+
+    int GetOutages() const {
+        return outages;
+    }
+
+    /// <summary>
+    /// The estimated time when all jobs in the queue will be finished, which is the simulated time if there are none.  A printer
+    /// that is down is expected back up after the mean time to fix its failure, or now if that has passed.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point GetFinishTime();
+
+    void UpdateDispatchIndex();
+
+    const char* Name() const {
+        return name;
+    }
+
+    /// <summary>
+    /// Jobs printing or waiting.
+    /// </summary>
+    size_t GetQueueLength() const {
+        return GetWaitingJobs() + (printing ? 1 : 0);
+    }
+
+    void LogRemainingJobs() const {
+        if (GetQueueLength() == 0) {
+            std::cout << "No jobs remaining." << std::endl;
+			return;
+        }
+
+        if (printing) {
+            std::cout << "Job " << currentJob.ID << " (" << currentJob.Pages << " Pages, " << currentJob.Pages - GetPagesPrinted() << " Remaining)";
+        }
+        else {
+            std::cout << "Waiting for repair";
+        }
+
+        if (sharedJobs) {
+            for (size_t i = 0; i < sharedJobs->jobs.Size(); i++) {
+                LogWaitingJob(sharedJobs->jobs[i]);
+            }
+
+            return;
+        }
+
+        for (int level = 0; level < waitingJobs.LevelCount(); level++) {
+            const RingQueue<PrintJob>& jobs = waitingJobs.Level(level);
+            for (size_t i = 0; i < jobs.Size(); i++) {
+                LogWaitingJob(jobs[i]);
+            }
+        }
+    }
+
+private:
+    size_t GetWaitingJobs() const {
+        return sharedJobs ? sharedJobs->jobs.Size() : waitingJobs.Size();
+    }
+
+    /// <summary>
+    /// Pages of the jobs queued or printing, including the pages already printed of the current job.
+    /// </summary>
+    int GetQueuedPages() const {
+        return totalPagesRemaining - (sharedJobs ? sharedJobs->stolenPages.load(std::memory_order_relaxed) : 0);
+    }
+
+    /// <summary>
+    /// Printing stops while the printer is down.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point GetPrintedUntil() const;
+
+    /// <summary>
+    /// When the current job will finish if the printer stays up.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point GetJobFinishTime() const {
+        return start + paused + profile.GetPrintTime(currentJob.Pages);
+    }
+
+    /// <summary>
+    /// A random time with an exponential distribution.
+    /// </summary>
+    std::chrono::milliseconds GetRandomTime(int meanSeconds) {
+        return std::chrono::milliseconds(static_cast<long long>(-std::log(1 - failureRandom.NextDouble()) * meanSeconds * MILLISECONDS_PER_SECOND));
+    }
+
+    static void LogWaitingJob(const PrintJob& job) {
+        char text[FORMAT_BUFFER_SIZE];
+        std::cout << ", ";
+        std::cout.write(text, job.ToString(text, text + FORMAT_BUFFER_SIZE) - text);
+    }
+};
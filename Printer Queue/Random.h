@@ -0,0 +1,93 @@
+/*
+Description - Small, fast, seedable random number generator (PCG32).  Each simulation owns its own generator, so simulations on
+    different threads don't share state, and the same seed and stream always produce the same numbers on every platform.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "Checkpoint.h"
+
+class Random {
+    std::uint64_t state = 0;
+    std::uint64_t increment = 1;//Selects the stream, must be odd
+public:
+    typedef std::uint32_t result_type;
+
+    Random(std::uint64_t seed = 0, std::uint64_t stream = 0) {
+        Seed(seed, stream);
+    }
+
+    /// <summary>
+    /// Generators with the same seed but different streams produce independent sequences.
+    /// </summary>
+    void Seed(std::uint64_t seed, std::uint64_t stream = 0) {
+        state = 0;
+        increment = (stream << 1) | 1;
+        Next();
+        state += seed;
+        Next();
+    }
+
+    std::uint32_t Next() {
+        std::uint64_t oldState = state;
+        state = oldState * 6364136223846793005ULL + increment;
+        std::uint32_t shifted = static_cast<std::uint32_t>(((oldState >> 18) ^ oldState) >> 27);
+        std::uint32_t rotation = static_cast<std::uint32_t>(oldState >> 59);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+
+    std::uint64_t Next64() {
+        std::uint64_t high = Next();
+        return (high << 32) | Next();
+    }
+
+    /// <returns>A number in [0, bound) without modulo bias.</returns>
+    std::uint32_t NextBelow(std::uint32_t bound) {
+        std::uint64_t product = static_cast<std::uint64_t>(Next()) * bound;
+        std::uint32_t low = static_cast<std::uint32_t>(product);
+        if (low < bound) {
+            std::uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = static_cast<std::uint64_t>(Next()) * bound;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+    /// <returns>A number in [min, max].</returns>
+    int NextInt(int min, int max) {
+        return min + static_cast<int>(NextBelow(static_cast<std::uint32_t>(max - min + 1)));
+    }
+
+    /// <returns>A number in [0, 1).</returns>
+    double NextDouble() {
+        return (Next64() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    void Save(CheckpointWriter& writer) const {
+        writer.Write(state);
+        writer.Write(increment);
+    }
+
+    void Restore(CheckpointReader& reader) {
+        reader.Read(state);
+        reader.Read(increment);
+    }
+
+    //Lets the generator be used with the <random> distributions
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return 0xFFFFFFFFu;
+    }
+
+    result_type operator()() {
+        return Next();
+    }
+};
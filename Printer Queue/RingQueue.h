@@ -0,0 +1,144 @@
+/*
+Description - First in, first out queue stored in a single ring buffer.  Unlike std::queue, which allocates its elements in chunks
+    spread across the heap, the elements are contiguous, the memory is kept when the queue is cleared so it can be reused, and the
+    elements can be read in order without removing them.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Checkpoint.h"
+
+template <typename T>
+class RingQueue {
+    std::vector<T> buffer;//Size is always 0 or a power of 2
+    size_t head = 0;//Index of the front element
+    size_t count = 0;
+public:
+    RingQueue() {}
+
+    /// <param name="capacity">Number of elements to make room for up front.  Rounded up to a power of 2.</param>
+    explicit RingQueue(size_t capacity) {
+        Reserve(capacity);
+    }
+
+    size_t Size() const {
+        return count;
+    }
+
+    bool Empty() const {
+        return count == 0;
+    }
+
+    size_t Capacity() const {
+        return buffer.size();
+    }
+
+    T& Front() {
+        return buffer[head];
+    }
+
+    const T& Front() const {
+        return buffer[head];
+    }
+
+    T& Back() {
+        return (*this)[count - 1];
+    }
+
+    /// <summary>
+    /// The element index places from the front.
+    /// </summary>
+    T& operator[](size_t index) {
+        return buffer[(head + index) & (buffer.size() - 1)];
+    }
+
+    const T& operator[](size_t index) const {
+        return buffer[(head + index) & (buffer.size() - 1)];
+    }
+
+    /// <summary>
+    /// Adds an element to the back.  The buffer doubles in size when it is full.
+    /// </summary>
+    void Push(const T& value) {
+        if (count == buffer.size())
+            Reserve(count + 1);
+
+        buffer[(head + count) & (buffer.size() - 1)] = value;
+        count++;
+    }
+
+    /// <summary>
+    /// Removes the front element.
+    /// </summary>
+    void Pop() {
+        head = (head + 1) & (buffer.size() - 1);
+        count--;
+    }
+
+    /// <summary>
+    /// Removes the back element.
+    /// </summary>
+    void PopBack() {
+        count--;
+    }
+
+    /// <summary>
+    /// Removes every element but keeps the memory.
+    /// </summary>
+    void Clear() {
+        head = 0;
+        count = 0;
+    }
+
+    /// <summary>
+    /// Writes the elements in order.  T must be trivially copyable.
+    /// </summary>
+    void Save(CheckpointWriter& writer) const {
+        writer.Write(static_cast<std::uint64_t>(count));
+        for (size_t i = 0; i < count; i++) {
+            writer.Write((*this)[i]);
+        }
+    }
+
+    /// <summary>
+    /// Replaces the elements with the ones saved.  The memory is reused if it is big enough.  Left empty if the reader fails.
+    /// </summary>
+    void Restore(CheckpointReader& reader) {
+        Clear();
+        size_t savedCount = reader.ReadCount(sizeof(T));
+        Reserve(savedCount);
+        for (size_t i = 0; i < savedCount; i++) {
+            reader.Read(buffer[i]);
+        }
+
+        //Elements after a failed read are garbage
+        count = reader.Failed() ? 0 : savedCount;
+    }
+
+    /// <summary>
+    /// Makes room for at least capacity elements without reallocating.
+    /// </summary>
+    void Reserve(size_t capacity) {
+        if (capacity <= buffer.size())
+            return;
+
+        size_t newSize = buffer.size() > 0 ? buffer.size() : 4;
+        while (newSize < capacity) {
+            newSize *= 2;
+        }
+
+        //Move the elements to the start of the new buffer so they're in order again
+        std::vector<T> newBuffer(newSize);
+        for (size_t i = 0; i < count; i++) {
+            newBuffer[i] = std::move((*this)[i]);
+        }
+
+        buffer.swap(newBuffer);
+        head = 0;
+    }
+};
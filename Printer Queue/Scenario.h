@@ -0,0 +1,548 @@
+/*
+Description - Scenario settings read at run time from a config file and the command line, so a scenario can be changed without
+    rebuilding.  Config files have one "key = value" per line, with blank lines and lines starting with # skipped.  On the command
+    line each setting is "--key=value" or "--key value", and "--config path" (or just the path) reads a config file first, so the
+    command line overrides it.  Keys ignore case and treat - and _ the same, so --seconds-per-job and SECONDS_PER_JOB are one key.
+*/
+
+#pragma once
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Simulation.h"
+
+class Scenario {
+    std::map<std::string, std::string> values;
+    std::map<std::string, std::string> givenKeys;//Each key as it was written, for messages
+    mutable std::map<std::string, bool> used;//Keys that have been read, to find the ones that are misspelled
+    mutable std::string error;
+public:
+    /// <summary>
+    /// Lowercases the text and removes spaces, - and _, which is how keys and names are compared.
+    /// </summary>
+    static std::string Normalize(const std::string& text) {
+        std::string normalized;
+        for (char c : text) {
+            if (c != ' ' && c != '-' && c != '_')
+                normalized += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        return normalized;
+    }
+
+    void Set(const std::string& key, const std::string& value) {
+        std::string normalized = Normalize(key);
+        values[normalized] = value;
+        givenKeys[normalized] = key;
+        used[normalized] = false;
+    }
+
+    bool Has(const std::string& key) const {
+        return values.count(Normalize(key)) > 0;
+    }
+
+    /// <returns>False if the file couldn't be read or has a line that isn't a setting.</returns>
+    bool LoadFile(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            error = "Failed to open the config file " + path;
+            return false;
+        }
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            std::string text = Trim(line);
+            if (text.empty() || text[0] == '#')
+                continue;
+
+            size_t equals = text.find('=');
+            if (equals == std::string::npos) {
+                error = path + " line " + std::to_string(lineNumber) + " isn't a setting: " + text;
+                return false;
+            }
+
+            Set(Trim(text.substr(0, equals)), Trim(text.substr(equals + 1)));
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Reads the config files named on the command line, then the settings on it.
+    /// </summary>
+    /// <returns>False if an argument isn't a setting or a config file couldn't be read.</returns>
+    bool ParseArguments(int argc, const char* const* argv) {
+        std::vector<std::pair<std::string, std::string>> arguments;
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            if (argument.compare(0, 2, "--") != 0) {
+                //A bare argument is a config file
+                arguments.push_back({ "config", argument });
+                continue;
+            }
+
+            size_t equals = argument.find('=');
+            if (equals != std::string::npos) {
+                arguments.push_back({ argument.substr(2, equals - 2), argument.substr(equals + 1) });
+            }
+            else if (Normalize(argument) == "help") {
+                arguments.push_back({ "help", "true" });
+            }
+            else if (i + 1 < argc) {
+                arguments.push_back({ argument.substr(2), argv[++i] });
+            }
+            else {
+                error = "No value for " + argument;
+                return false;
+            }
+        }
+
+        for (const std::pair<std::string, std::string>& argument : arguments) {
+            if (Normalize(argument.first) == "config" && !LoadFile(argument.second))
+                return false;
+        }
+
+        for (const std::pair<std::string, std::string>& argument : arguments) {
+            if (Normalize(argument.first) != "config")
+                Set(argument.first, argument.second);
+        }
+
+        return true;
+    }
+
+    //Each Get() leaves the value alone if the key isn't set, and returns false with Error() set if the value can't be read
+
+    bool Get(const std::string& key, std::string& value) const {
+        const std::string* text = Find(key);
+        if (text != nullptr)
+            value = *text;
+
+        return true;
+    }
+
+    bool Get(const std::string& key, long long& value) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        char* end;
+        long long number = std::strtoll(text->c_str(), &end, 10);
+        if (text->empty() || *end != '\0')
+            return Invalid(key, *text, "a whole number");
+
+        value = number;
+        return true;
+    }
+
+    bool Get(const std::string& key, int& value) const {
+        long long number = value;
+        if (!Get(key, number))
+            return false;
+
+        if (number < std::numeric_limits<int>::min() || number > std::numeric_limits<int>::max())
+            return Invalid(key, *Find(key), "a smaller number");
+
+        value = static_cast<int>(number);
+        return true;
+    }
+
+    /// <summary>
+    /// Get() for a whole number that must be from min to max.
+    /// </summary>
+    bool Get(const std::string& key, long long& value, long long min, long long max = std::numeric_limits<long long>::max()) const {
+        const std::string* text = Find(key);
+        long long number = value;
+        if (text == nullptr || !Get(key, number))
+            return text == nullptr;
+
+        if (number < min || number > max)
+            return Invalid(key, *text, RangeText(min, max));
+
+        value = number;
+        return true;
+    }
+
+    bool Get(const std::string& key, int& value, int min, int max = std::numeric_limits<int>::max()) const {
+        const std::string* text = Find(key);
+        int number = value;
+        if (text == nullptr || !Get(key, number))
+            return text == nullptr;
+
+        if (number < min || number > max)
+            return Invalid(key, *text, RangeText(min, max));
+
+        value = number;
+        return true;
+    }
+
+    bool Get(const std::string& key, unsigned long long& value) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        char* end;
+        unsigned long long number = std::strtoull(text->c_str(), &end, 10);
+        if (text->empty() || *end != '\0' || (*text)[0] == '-')
+            return Invalid(key, *text, "a positive whole number");
+
+        value = number;
+        return true;
+    }
+
+    bool Get(const std::string& key, double& value) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        char* end;
+        double number = std::strtod(text->c_str(), &end);
+        if (text->empty() || *end != '\0')
+            return Invalid(key, *text, "a number");
+
+        value = number;
+        return true;
+    }
+
+    /// <summary>
+    /// Get() for a number that must be more than 0.
+    /// </summary>
+    bool GetPositive(const std::string& key, double& value) const {
+        const std::string* text = Find(key);
+        double number = value;
+        if (text == nullptr || !Get(key, number))
+            return text == nullptr;
+
+        if (!(number > 0))
+            return Invalid(key, *text, "a number more than 0");
+
+        value = number;
+        return true;
+    }
+
+    /// <summary>
+    /// true, yes, on, and 1, or false, no, off, and 0.
+    /// </summary>
+    bool Get(const std::string& key, bool& value) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        std::string normalized = Normalize(*text);
+        if (normalized == "true" || normalized == "yes" || normalized == "on" || normalized == "1") {
+            value = true;
+        }
+        else if (normalized == "false" || normalized == "no" || normalized == "off" || normalized == "0") {
+            value = false;
+        }
+        else {
+            return Invalid(key, *text, "true or false");
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Reads an enum by the name of its value, such as DiscreteEvent or discrete_event.
+    /// </summary>
+    template <typename Enum>
+    bool Get(const std::string& key, Enum& value, const std::vector<std::pair<const char*, Enum>>& names) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        std::string normalized = Normalize(*text);
+        std::string choices;
+        for (const std::pair<const char*, Enum>& name : names) {
+            if (normalized == Normalize(name.first)) {
+                value = name.second;
+                return true;
+            }
+
+            choices += (choices.empty() ? "" : ", ") + std::string(name.first);
+        }
+
+        return Invalid(key, *text, "one of " + choices);
+    }
+
+    /// <summary>
+    /// Reads a comma separated list of whole numbers, each at least min.
+    /// </summary>
+    bool GetList(const std::string& key, std::vector<int>& list, int min = std::numeric_limits<int>::min()) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        std::vector<int> numbers;
+        for (const std::string& item : Split(*text, ',')) {
+            char* end;
+            long number = std::strtol(item.c_str(), &end, 10);
+            if (item.empty() || *end != '\0' || number < min || number > std::numeric_limits<int>::max())
+                return Invalid(key, *text, min == std::numeric_limits<int>::min() ? "a list of whole numbers" : "a list of whole numbers of at least " + std::to_string(min));
+
+            numbers.push_back(static_cast<int>(number));
+        }
+
+        list = numbers;
+        return true;
+    }
+
+    /// <summary>
+    /// Reads a comma separated list of numbers.
+    /// </summary>
+    bool GetList(const std::string& key, std::vector<double>& list) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        std::vector<double> numbers;
+        for (const std::string& item : Split(*text, ',')) {
+            char* end;
+            double number = std::strtod(item.c_str(), &end);
+            if (item.empty() || *end != '\0')
+                return Invalid(key, *text, "a list of numbers");
+
+            numbers.push_back(number);
+        }
+
+        list = numbers;
+        return true;
+    }
+
+    /// <summary>
+    /// Reads a list of enum names separated by commas.
+    /// </summary>
+    template <typename Enum>
+    bool GetList(const std::string& key, std::vector<Enum>& list, const std::vector<std::pair<const char*, Enum>>& names) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        std::vector<Enum> items;
+        for (const std::string& item : Split(*text, ',')) {
+            Scenario single;
+            single.Set(key, item);
+            Enum value{};
+            if (!single.Get(key, value, names)) {
+                error = single.Error();
+                return false;
+            }
+
+            items.push_back(value);
+        }
+
+        list = items;
+        return true;
+    }
+
+    /// <summary>
+    /// Printer profiles separated by semicolons, each being the PrinterProfile values in order separated by commas.  Values that are
+    /// left out keep their defaults, so "7; 30, 5000" is a 7 sheets per minute printer and a 30 with a 5 second setup.
+    /// </summary>
+    bool Get(const std::string& key, std::vector<PrinterProfile>& profiles) const {
+        const std::string* text = Find(key);
+        if (text == nullptr)
+            return true;
+
+        std::vector<PrinterProfile> parsed;
+        for (const std::string& item : Split(*text, ';')) {
+            std::vector<double> numbers;
+            for (const std::string& field : Split(item, ',')) {
+                char* end;
+                numbers.push_back(std::strtod(field.c_str(), &end));
+                if (field.empty() || *end != '\0')
+                    numbers.clear();
+            }
+
+            //Print times are whole milliseconds per sheet, so a faster printer would print in no time
+            if (numbers.empty() || numbers.size() > 6 || numbers[0] < 1 || numbers[0] > MAX_SHEETS_PER_MINUTE)
+                return Invalid(key, *text, "printer profiles of 1 to " + std::to_string(MAX_SHEETS_PER_MINUTE) + " sheets per minute, such as 7; 30, 5000; 60, 10000, 5400, 0.1");
+
+            numbers.resize(6, -1);//Left out
+            PrinterProfile profile;
+            profile.sheetsPerMinute = static_cast<int>(numbers[0]);
+            if (numbers[1] >= 0)
+                profile.setupMilliseconds = static_cast<int>(numbers[1]);
+
+            if (numbers[2] >= 0)
+                profile.meanSecondsBetweenFailures = static_cast<int>(numbers[2]);
+
+            if (numbers[3] >= 0)
+                profile.outageFraction = numbers[3];
+
+            if (numbers[4] >= 0)
+                profile.meanSecondsToClearStall = static_cast<int>(numbers[4]);
+
+            if (numbers[5] >= 0)
+                profile.meanSecondsToRepair = static_cast<int>(numbers[5]);
+
+            parsed.push_back(profile);
+        }
+
+        profiles = parsed;
+        return true;
+    }
+
+    /// <returns>The keys that were set but never read, which are usually misspelled.</returns>
+    std::vector<std::string> GetUnusedKeys() const {
+        std::vector<std::string> keys;
+        for (const auto& entry : used) {
+            if (!entry.second)
+                keys.push_back(givenKeys.at(entry.first));
+        }
+
+        return keys;
+    }
+
+    const std::string& Error() const {
+        return error;
+    }
+
+private:
+    const std::string* Find(const std::string& key) const {
+        std::string normalized = Normalize(key);
+        auto value = values.find(normalized);
+        if (value == values.end())
+            return nullptr;
+
+        used[normalized] = true;
+        return &value->second;
+    }
+
+    bool Invalid(const std::string& key, const std::string& text, const std::string& expected) const {
+        error = "Invalid value for " + key + ": \"" + text + "\", expected " + expected;
+        return false;
+    }
+
+    /// <returns>Such as "a whole number from 1 to 64" or "a whole number of at least 0".</returns>
+    template <typename Number>
+    static std::string RangeText(Number min, Number max) {
+        if (max == std::numeric_limits<Number>::max())
+            return "a whole number of at least " + std::to_string(min);
+
+        return "a whole number from " + std::to_string(min) + " to " + std::to_string(max);
+    }
+
+    static std::string Trim(const std::string& text) {
+        size_t first = 0;
+        size_t last = text.size();
+        while (first < last && std::isspace(static_cast<unsigned char>(text[first]))) {
+            first++;
+        }
+
+        while (last > first && std::isspace(static_cast<unsigned char>(text[last - 1]))) {
+            last--;
+        }
+
+        return text.substr(first, last - first);
+    }
+
+    static std::vector<std::string> Split(const std::string& text, char separator) {
+        std::vector<std::string> items;
+        size_t first = 0;
+        while (true) {
+            size_t end = text.find(separator, first);
+            items.push_back(Trim(text.substr(first, end == std::string::npos ? std::string::npos : end - first)));
+            if (end == std::string::npos)
+                return items;
+
+            first = end + 1;
+        }
+    }
+};
+
+inline const std::vector<std::pair<const char*, DispatchPolicy>>& GetDispatchPolicyNames() {
+    static const std::vector<std::pair<const char*, DispatchPolicy>> names = {
+        { "LeastPagesLeft", DispatchPolicy::LeastPagesLeft },
+        { "ShortestQueue", DispatchPolicy::ShortestQueue },
+        { "RoundRobin", DispatchPolicy::RoundRobin },
+        { "PowerOfTwoChoices", DispatchPolicy::PowerOfTwoChoices },
+        { "EarliestCompletion", DispatchPolicy::EarliestCompletion }
+    };
+
+    return names;
+}
+
+/// <summary>
+/// Reads the settings of a simulation from a scenario.  Each key is the name of the driver's setting, such as NUMBER_OF_PRINTERS.
+/// SHEETS_PER_MINUTE sets the speed of the printers when there are no PRINTER_PROFILES.
+/// </summary>
+/// <returns>False with scenario.Error() set if a value can't be read or is out of range.</returns>
+inline bool ReadSimulationSettings(const Scenario& scenario, SimulationSettings& settings) {
+    int sheetsPerMinute = 0;
+    bool read = scenario.Get("NUMBER_OF_PRINTERS", settings.printers, 1)
+        && scenario.Get("SIMULATION_SPEED", settings.simulationSpeed, 1)
+        && scenario.Get("SECONDS_TO_SIMULATE", settings.secondsToSimulate, 0)
+        && scenario.GetPositive("SECONDS_PER_JOB", settings.secondsPerJob)
+        && scenario.Get("ARRIVAL_PATTERN", settings.arrivals.pattern, {
+            { "Fixed", ArrivalPattern::Fixed },
+            { "Poisson", ArrivalPattern::Poisson },
+            { "TimeOfDay", ArrivalPattern::TimeOfDay },
+            { "Bursty", ArrivalPattern::Bursty } })
+        && scenario.GetList("ARRIVAL_RATES", settings.arrivals.rates)
+        && scenario.Get("ARRIVAL_RATE_SECONDS", settings.arrivals.ratePeriodSeconds, 1)
+        && scenario.GetPositive("BURST_RATE", settings.arrivals.burstRate)
+        && scenario.Get("MEAN_SECONDS_BETWEEN_BURSTS", settings.arrivals.meanSecondsBetweenBursts, 1)
+        && scenario.Get("MEAN_BURST_SECONDS", settings.arrivals.meanBurstSeconds, 1)
+        && scenario.Get("SIMULATION_ENGINE", settings.engine, {
+            { "RealTime", SimulationEngine::RealTime },
+            { "RealTimeThreaded", SimulationEngine::RealTimeThreaded },
+            { "DiscreteEvent", SimulationEngine::DiscreteEvent },
+            { "Sharded", SimulationEngine::Sharded } })
+        && scenario.Get("CLOCK_MODE", settings.clockMode, {
+            { "Polling", ClockMode::Polling },
+            { "Paced", ClockMode::Paced } })
+        && scenario.Get("FLEET_BACKEND", settings.fleetBackend, {
+            { "Heap", FleetBackend::Heap },
+            { "Arrays", FleetBackend::Arrays } })
+        && scenario.Get("DISPATCH_POLICY", settings.dispatchPolicy, GetDispatchPolicyNames())
+        && scenario.Get("WORKER_THREADS", settings.workerThreads, 0)
+        && scenario.Get("SHARDS", settings.shards, 0)
+        && scenario.Get("MIGRATION_SECONDS", settings.migrationSeconds, 1)
+        && scenario.Get("MIGRATION_PAGES", settings.migrationPages, 0)
+        && scenario.Get("ADMISSION_POLICY", settings.admissionPolicy, {
+            { "AcceptAll", AdmissionPolicy::AcceptAll },
+            { "Reject", AdmissionPolicy::Reject },
+            { "Defer", AdmissionPolicy::Defer },
+            { "ShedLarge", AdmissionPolicy::ShedLarge } })
+        && scenario.Get("MAX_BACKLOG_PAGES", settings.maxBacklogPages, 0)
+        && scenario.Get("MAX_QUEUE_LENGTH", settings.maxQueueLength, 0)
+        && scenario.Get("SHED_PAGES", settings.shedPages, 0)
+        && scenario.Get("MAX_DEFERRED_JOBS", settings.maxDeferredJobs, 0)
+        && scenario.Get("QUEUE_DISCIPLINE", settings.queueDiscipline, {
+            { "Fifo", QueueDiscipline::Fifo },
+            { "StrictPriority", QueueDiscipline::StrictPriority },
+            { "WeightedFair", QueueDiscipline::WeightedFair },
+            { "ShortestJobFirst", QueueDiscipline::ShortestJobFirst } })
+        && scenario.Get("PRIORITY_CLASSES", settings.priorityClasses, 1, JobQueue<PrintJob>::MAX_LEVELS)
+        && scenario.Get("SPLIT_PAGES", settings.splitPages, 0)
+        && scenario.Get("MAX_SPLIT_PARTS", settings.maxSplitParts, 1)
+        && scenario.Get("WORK_STEALING", settings.workStealing)
+        && scenario.Get("SHEETS_PER_MINUTE", sheetsPerMinute, 1, MAX_SHEETS_PER_MINUTE)
+        && scenario.Get("PRINTER_PROFILES", settings.printerProfiles)
+        && scenario.Get("WARM_UP_SECONDS", settings.warmUpSeconds, 0)
+        && scenario.Get("TARGET_PRECISION", settings.targetPrecision)
+        && scenario.Get("LATENCY_BATCH_JOBS", settings.latencyBatchJobs, 1)
+        && scenario.Get("MIN_LATENCY_BATCHES", settings.minLatencyBatches, 0)
+        && scenario.Get("SEED", settings.seed)
+        && scenario.Get("STREAM", settings.stream)
+        && scenario.Get("TRACE_FILE", settings.traceFile);
+    if (!read)
+        return false;
+
+    if (sheetsPerMinute > 0 && settings.printerProfiles.empty()) {
+        PrinterProfile profile;
+        profile.sheetsPerMinute = sheetsPerMinute;
+        settings.printerProfiles.push_back(profile);
+    }
+
+    return true;
+}
@@ -0,0 +1,2510 @@
+/*
+Description - The printer queue simulation.  A Simulation owns all of its state, so multiple simulations can run side by side on
+    different threads, and a Simulation can be set up again to reuse its memory for the next run.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "AliasTable.h"
+#include "ArrivalProcess.h"
+#include "BatchMeans.h"
+#include "Checkpoint.h"
+#include "DispatchIndex.h"
+#include "DispatchPolicy.h"
+#include "FleetArrays.h"
+#include "FleetBacklog.h"
+#include "Histogram.h"
+#include "Instrumentation.h"
+#include "JobQueue.h"
+#include "JobTrace.h"
+#include "Logger.h"
+#include "MpscQueue.h"
+#include "Printer.h"
+#include "Random.h"
+#include "RingQueue.h"
+#include "SimulationSettings.h"
+
+/// <summary>
+/// Types of scheduled events.  The DiscreteEvent engine processes every type, while the RealTime engine creates jobs with its clock
+/// instead of JobArrival events.  Events at the same time are processed in this order, which matches Update() updating the printers
+/// before creating a new job.  A job starts at the same instant as the completion, arrival, or repair that makes it the front of an
+/// idle printer's queue, so starting a job is handled inside those events.
+/// </summary>
+enum class EventType {
+    JobCompletion,
+    PrinterRepair,
+    PrinterFailure,
+    JobArrival,
+    JobTransfer//Sharded only.  A job sent from another shard arrives.
+};
+
+/// <summary>
+/// A timestamped event.
+/// </summary>
+struct Event {
+    std::chrono::high_resolution_clock::time_point time;
+    EventType type;
+    int printerID;//Printer finishing a job, failing, or being repaired
+    int generation;//JobCompletion only.  The printer's generation when it was scheduled.  Stale once the job has been paused.
+    long long sequence;//Keeps events with the same time and type in the order they were scheduled
+
+    bool operator>(const Event& other) const {
+        if (time != other.time)
+            return time > other.time;
+
+        if (type != other.type)
+            return type > other.type;
+
+        return sequence > other.sequence;
+    }
+};
+
+class Simulation {
+    friend class Printer;
+
+    SimulationSettings settings;
+
+    /// <summary>
+    /// Tracks the simulated time of the simulation.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point simulatedTime;
+
+    /// <summary>
+    /// Tracks the real time.  Used to update the simulated time.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point realTime;
+
+    /// <summary>
+    /// How late the Paced clock woke up for each tick it slept until.
+    /// </summary>
+    std::chrono::high_resolution_clock::duration maxLag{};
+    std::chrono::high_resolution_clock::duration totalLag{};
+    long long lagSamples = 0;
+
+    std::chrono::high_resolution_clock::time_point startTime;
+    std::chrono::high_resolution_clock::time_point nextArrivalTime;//Of the next random job
+    std::chrono::high_resolution_clock::time_point lastUpdate;
+    std::vector<Printer> printers;
+    DispatchIndex dispatchIndex;
+    FleetArrays fleetArrays;
+
+    /// <summary>
+    /// Pending events, earliest first.
+    /// </summary>
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    long long eventCount = 0;
+    bool arrivalScheduled = false;//The DiscreteEvent engine has a JobArrival pending, which carries on into the next Run()
+    int jobCount = 0;
+    std::vector<int> finishedPrinters;//Reused by Update() to avoid allocating
+    std::vector<Event> printerEvents;//Failures and repairs.  Reused by Update().
+    Random random;
+    Random dispatchRandom;//Used by the dispatch policies, so they don't change the jobs that are created
+    Random priorityRandom;//Gives the random jobs their priorities, so the pages of the jobs are the same with any number of classes
+    ArrivalProcess arrivals;
+    int roundRobinNext = 0;//Next printer for RoundRobinPolicy
+    const AliasTable* jobSizes = nullptr;
+
+    /// <summary>
+    /// Job sizes are sampled JOB_SIZE_BATCH at a time instead of one per job.
+    /// </summary>
+    static const int JOB_SIZE_BATCH = 256;
+    int nextJobSizes[JOB_SIZE_BATCH];
+    int nextJobSizeIndex = JOB_SIZE_BATCH;
+
+    /// <summary>
+    /// The trace being replayed and the next job in it.  The first job in the trace arrives at the start of the simulation.
+    /// </summary>
+    JobTrace trace;
+    TraceJob nextTraceJob{};
+    bool hasTraceJob = false;
+    long long firstTraceArrival = 0;
+
+    //Milliseconds for each job
+    Histogram queueWaits;//From when the job was created until it started printing
+    Histogram serviceTimes;//From when the job started printing until it finished
+    Histogram latencies;//From when the job was created until it finished
+    std::vector<Histogram> priorityLatencies;//Latencies of each priority class
+
+    /// <summary>
+    /// Everything measured is reset at measureStart, the end of the warm up.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point measureStart;
+    bool measuring = true;
+    BatchMeans latencyBatches;//Of the measured latencies
+    bool steadyState = false;//The mean latency reached targetPrecision, so the run stops
+
+    /// <summary>
+    /// Backlog of this simulation's printers.  The dispatcher of RealTimeThreaded keeps it from the jobs it books on the workers'
+    /// printers instead, so workers don't keep one.
+    /// </summary>
+    FleetBacklog backlog;
+
+    //Admission control
+    RingQueue<PrintJob> deferredJobs;
+    long long rejectedJobs = 0;
+    long long shedJobs = 0;
+    long long deferredJobCount = 0;//Jobs that have been deferred, including the ones admitted later
+    bool retryDeferredJobs = false;//A job finished while jobs were deferred, so the fleet may have room for them
+
+    /// <summary>
+    /// A job that was split into parts.  The parts can finish on different threads when threaded, so the parts left are atomic.
+    /// A slot can be reused once its parts left is 0.
+    /// </summary>
+    struct SplitJob {
+        std::atomic<int> partsLeft{ 0 };
+        int pages = 0;//Of the whole job.  Only written while partsLeft is 0.
+    };
+
+    static const int MAX_SPLIT_JOBS = 1 << 12;//Jobs that are split while all of the slots are in use aren't split
+
+    std::unique_ptr<SplitJob[]> splitJobs;//Only allocated when splitting.  The dispatcher's are used by its workers.
+    int nextSplitSlot = 0;
+    long long splitJobCount = 0;
+    long long splitPartCount = 0;
+    long long stolenJobs = 0;
+
+    bool uniformSpeeds = true;//Every printer prints a job in the same time
+    bool printersFail = false;
+
+    //RealTimeThreaded.  The simulation that Run() is called on is the dispatcher.  It creates the jobs and hands each one to the
+    //worker with the selected printer.  Each worker is a Simulation that owns a group of the printers.
+
+    struct JobHandoff {
+        PrintJob job;
+        int printerID;//In the worker
+    };
+
+    /// <summary>
+    /// Sent by a worker when one of its printers steals a job, so the dispatcher can move the job's booking to the thief.
+    /// </summary>
+    struct JobSteal {
+        int victimID;
+        int thiefID;
+        int pages;
+    };
+
+    static const size_t JOB_HANDOFF_CAPACITY = 1 << 12;
+
+    std::vector<std::unique_ptr<Simulation>> workers;
+    std::vector<std::thread> threads;
+    std::vector<int> printerWorkers;//Worker of each printer
+
+    /// <summary>
+    /// The time each printer will finish the jobs it has been handed, or DispatchIndex::NO_JOBS.  This is known as soon as a job is
+    /// handed out, so the dispatcher never needs to read the workers' printers.  Jobs stolen by another printer are moved to it
+    /// when its worker reports the steal.
+    /// </summary>
+    std::vector<long long> bookedFinishTimes;
+    std::vector<int> bookingGenerations;//Changes when a printer's completions are scheduled again, so the old ones are ignored
+    MpscQueue<JobSteal> stealReports;//Only used when work stealing
+    std::unique_ptr<std::atomic<int>[]> queueLengths;//Written by the workers, only used by thieves to pick a victim
+    std::atomic<long long> clock{ 0 };//simulatedTime ticks.  Set after the jobs up to that time have been handed out.
+    std::atomic<bool> workersStopping{ false };
+
+    Simulation* dispatcher = nullptr;//Set on workers
+    int firstPrinterID = 0;
+    MpscQueue<JobHandoff> inbox;
+    std::vector<RingQueue<int>> bookedJobPages;//Pages of each job booked on each printer that hasn't finished, oldest first
+
+    //Sharded.  The simulation that Run() is called on coordinates the shards, which are kept in workers so the totals of the
+    //printers include them.  Each shard is a DiscreteEvent simulation that owns a group of the printers and creates its own jobs.
+    //The shards run in windows that end migrationSeconds after the earliest event of any shard, then exchange the jobs sent in the
+    //window before planning the next one.
+
+    struct JobTransfer {
+        PrintJob job;
+        std::chrono::high_resolution_clock::time_point arrival;
+        int fromShard;
+        long long sequence;//Of the jobs sent by fromShard, so transfers can be put in an order that doesn't depend on the threads
+    };
+
+    static const size_t JOB_TRANSFER_CAPACITY = 1 << 12;
+
+    Simulation* coordinator = nullptr;//Set on shards
+    int shardID = 0;
+    int shardCount = 1;//Job IDs are interleaved over the shards so they stay unique
+    MpscQueue<JobTransfer> mailbox;
+    std::vector<JobTransfer> receivedTransfers;//Taken out of the mailbox, waiting for the end of the window
+    RingQueue<JobTransfer> incomingTransfers;//Scheduled as JobTransfer events, earliest first
+    long long sentTransfers = 0;
+    long long migratedJobs = 0;
+    std::vector<double> shardLoads;//Backlog pages per printer of each shard at the start of the window, and on shards the jobs sent since
+    std::chrono::high_resolution_clock::time_point nextShardEvent;//Reported by the shard at the end of each window
+
+    //Coordinator only.  The window is planned by the last shard to reach the barrier and only read by the shards after it.
+    std::chrono::high_resolution_clock::time_point runEnd;
+    std::chrono::high_resolution_clock::time_point windowEnd;
+    bool finalWindow = false;
+    bool shardsDone = false;
+    long long fleetPeakPages = 0;//Highest total of the shards' backlogs at the end of a window after the warm up
+    std::atomic<int> shardsWaiting{ 0 };
+    std::atomic<int> barrierGeneration{ 0 };
+public:
+    Simulation() {}
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    /// <summary>
+    /// Resets the simulation and creates the printers.  Can be called again to start a new run without reallocating.
+    /// </summary>
+    /// <returns>False if the trace couldn't be opened by this simulation or one of its workers or shards.</returns>
+    bool Setup(const SimulationSettings& simulationSettings) {
+        settings = simulationSettings;
+        //Each shard creates its own jobs, so it has its own streams for them.  The printers keep the fleet's, so their failures
+        //don't depend on how the fleet is split.
+        unsigned long long jobStream = settings.stream | (static_cast<unsigned long long>(shardID) << 40);
+        random.Seed(settings.seed, jobStream);
+        dispatchRandom.Seed(settings.seed, jobStream | (1ULL << 62));
+        priorityRandom.Seed(settings.seed, jobStream | (1ULL << 61));
+        settings.migrationSeconds = std::max(1, settings.migrationSeconds);
+        arrivals.Setup(settings.arrivals, settings.secondsPerJob, settings.seed, jobStream | (1ULL << 59));
+        settings.priorityClasses = std::max(1, std::min(settings.priorityClasses, JobQueue<PrintJob>::MAX_LEVELS));
+        jobSizes = settings.jobSizes != nullptr ? settings.jobSizes : &GetDefaultJobSizes();
+        nextJobSizeIndex = JOB_SIZE_BATCH;
+
+        dispatchIndex.Clear();
+        fleetArrays.Clear();
+        events = {};
+        eventCount = 0;
+        arrivalScheduled = false;
+        jobCount = 0;
+        roundRobinNext = 0;
+        queueWaits.Clear();
+        serviceTimes.Clear();
+        latencies.Clear();
+        priorityLatencies.resize(settings.priorityClasses);
+        for (Histogram& histogram : priorityLatencies) {
+            histogram.Clear();
+        }
+        maxLag = {};
+        totalLag = {};
+        lagSamples = 0;
+
+        //Create printers.  Printers from the last run are reused so their queues don't need to be allocated again.
+        //The workers own them when threaded, and the shards when sharded
+        bool coordinatesShards = settings.engine == SimulationEngine::Sharded;
+        int ownPrinters = settings.engine == SimulationEngine::RealTimeThreaded || coordinatesShards ? 0 : settings.printers;
+        if (printers.size() > ownPrinters)
+            printers.erase(printers.begin() + ownPrinters, printers.end());
+
+        backlog.Clear(settings.printers);
+        deferredJobs.Clear();
+        retryDeferredJobs = false;
+        rejectedJobs = 0;
+        shedJobs = 0;
+        deferredJobCount = 0;
+        splitJobCount = 0;
+        splitPartCount = 0;
+        nextSplitSlot = 0;
+        stolenJobs = 0;
+        receivedTransfers.clear();
+        incomingTransfers.Clear();
+        fleetPeakPages = 0;
+        sentTransfers = 0;
+        migratedJobs = 0;
+        if (settings.splitPages > 0 && dispatcher == nullptr && !coordinatesShards) {
+            if (!splitJobs)
+                splitJobs.reset(new SplitJob[MAX_SPLIT_JOBS]);
+
+            for (int i = 0; i < MAX_SPLIT_JOBS; i++) {
+                splitJobs[i].partsLeft.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        for (int i = 0; i < (coordinatesShards ? 0 : settings.printers); i++) {
+            if (i < ownPrinters) {
+                if (i == printers.size())
+                    printers.push_back(Printer(this, i, firstPrinterID));
+
+                printers[i].Reset(settings, settings.workStealing && dispatcher != nullptr);
+            }
+
+            dispatchIndex.Add();
+            fleetArrays.Add();
+        }
+
+        uniformSpeeds = true;
+        printersFail = false;
+        for (const PrinterProfile& profile : settings.printerProfiles) {
+            const PrinterProfile& first = settings.printerProfiles[0];
+            if (profile.sheetsPerMinute != first.sheetsPerMinute || profile.setupMilliseconds != first.setupMilliseconds)
+                uniformSpeeds = false;
+
+            if (profile.meanSecondsBetweenFailures > 0)
+                printersFail = true;
+        }
+
+        //Shards start at the coordinator's time, so their events line up
+        simulatedTime = coordinator != nullptr ? coordinator->startTime : std::chrono::high_resolution_clock::now();
+        startTime = simulatedTime;
+        realTime = simulatedTime;
+        nextArrivalTime = startTime + arrivals.Next(std::chrono::high_resolution_clock::duration::zero());
+        lastUpdate = simulatedTime;
+        measureStart = startTime + std::chrono::seconds(std::max(0, settings.warmUpSeconds));
+        measuring = settings.warmUpSeconds <= 0;
+        latencyBatches.Reset(settings.latencyBatchJobs);
+        steadyState = false;
+
+        //Workers are started at the dispatcher's time by SetupWorkers()
+        if (dispatcher == nullptr)
+            ScheduleFailures();
+
+        workers.clear();
+        if (settings.engine == SimulationEngine::RealTimeThreaded && !SetupWorkers())
+            return false;
+
+        if (coordinatesShards && !SetupShards())
+            return false;
+
+        trace.Close();
+        hasTraceJob = false;
+        if (UsingTrace()) {
+            if (!trace.Open(settings.traceFile))
+                return false;
+
+            hasTraceJob = trace.Next(nextTraceJob);
+            firstTraceArrival = nextTraceJob.arrival;
+
+            //Each shard replays every shardCount-th job, starting with job shardID
+            for (int i = 0; hasTraceJob && i < shardID; i++) {
+                hasTraceJob = trace.Next(nextTraceJob);
+            }
+        }
+
+        return true;
+    }
+
+    void Run() {
+        switch (settings.dispatchPolicy) {
+        case DispatchPolicy::LeastPagesLeft:
+            Run<LeastPagesLeftPolicy>();
+            break;
+        case DispatchPolicy::ShortestQueue:
+            Run<ShortestQueuePolicy>();
+            break;
+        case DispatchPolicy::RoundRobin:
+            Run<RoundRobinPolicy>();
+            break;
+        case DispatchPolicy::PowerOfTwoChoices:
+            Run<PowerOfTwoChoicesPolicy>();
+            break;
+        case DispatchPolicy::EarliestCompletion:
+            Run<EarliestCompletionPolicy>();
+            break;
+        }
+    }
+
+    /// <summary>
+    /// Runs the simulation with a dispatch policy chosen at compile time.
+    /// </summary>
+    template <typename Policy>
+    void Run() {
+        Policy policy;
+        switch (settings.engine) {
+        case SimulationEngine::RealTime:
+            RunRealTime(policy);
+            break;
+        case SimulationEngine::RealTimeThreaded:
+            RunRealTimeThreaded(policy);
+            break;
+        case SimulationEngine::DiscreteEvent:
+            if (coordinator != nullptr) {
+                RunShard(policy);
+            }
+            else {
+                RunDiscreteEvent(policy);
+            }
+            break;
+        case SimulationEngine::Sharded:
+            RunSharded();
+            break;
+        }
+    }
+
+    void Cleanup() {
+        if (settings.logger == nullptr)
+            return;
+
+        //Finish writing the events before the final status
+        settings.logger->Stop();
+        if (!settings.logger->IsEnabled(LogLevel::Summary))
+            return;
+
+        //Print the final status of the printers
+        char time[FORMAT_BUFFER_SIZE];
+        *GetTime(time, time + FORMAT_BUFFER_SIZE - 1) = '\0';
+        std::cout << "\nSimulation ended at " << time << ".  Seed: " << settings.seed << "\n";
+        if (lagSamples > 0) {
+            std::cout << std::fixed << std::setprecision(2) << "Clock lag: max " << std::chrono::duration<double, std::milli>(maxLag).count()
+                << " ms, mean " << std::chrono::duration<double, std::milli>(GetMeanLag()).count() << " ms\n";
+        }
+
+        if (settings.warmUpSeconds > 0) {
+            std::cout << std::fixed << std::setprecision(1) << "Measured " << std::chrono::duration<double>(GetMeasuredDuration()).count() / SECONDS_PER_MINUTE
+                << " minutes after a warm up of " << settings.warmUpSeconds / static_cast<double>(SECONDS_PER_MINUTE) << " minutes\n";
+        }
+
+        if (settings.targetPrecision > 0 && workers.empty()) {
+            std::cout << std::fixed << std::setprecision(1) << "Mean latency: " << latencyBatches.Mean() / MILLISECONDS_PER_SECOND << " s +/- "
+                << latencyBatches.HalfWidth() / MILLISECONDS_PER_SECOND << " s (95%, " << latencyBatches.Batches() << " batches of " << settings.latencyBatchJobs << " jobs), ";
+            if (steadyState) {
+                std::cout << "steady state after " << std::chrono::duration<double>(simulatedTime - startTime).count() / SECONDS_PER_MINUTE << " minutes\n";
+            }
+            else {
+                std::cout << "no steady state within the run\n";
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(1) << "Utilization: " << GetUtilization() * 100 << "%\n";
+        LogBacklog();
+        if (settings.admissionPolicy != AdmissionPolicy::AcceptAll) {
+            //Shards defer their own jobs
+            size_t stillDeferred = deferredJobs.Size();
+            for (int i = 0; i < workers.size(); i++) {
+                stillDeferred += workers[i]->deferredJobs.Size();
+            }
+
+            std::cout << "Admission: " << rejectedJobs << " rejected, " << shedJobs << " shed, " << deferredJobCount << " deferred ("
+                << stillDeferred << " still deferred)\n";
+        }
+
+        if (settings.splitPages > 0)
+            std::cout << "Split " << splitJobCount << " jobs into " << splitPartCount << " parts\n";
+
+        if (settings.workStealing)
+            std::cout << "Stole " << stolenJobs << " jobs\n";
+
+        if (settings.engine == SimulationEngine::Sharded) {
+            //Jobs sent in the last migrationSeconds arrive after the run, so no printer or backlog has them yet
+            size_t sendingJobs = 0;
+            long long sendingPages = 0;
+            for (int i = 0; i < workers.size(); i++) {
+                const RingQueue<JobTransfer>& transfers = workers[i]->incomingTransfers;
+                sendingJobs += transfers.Size();
+                for (size_t t = 0; t < transfers.Size(); t++) {
+                    sendingPages += transfers[t].job.Pages;
+                }
+            }
+
+            std::cout << "Migrated " << migratedJobs << " jobs between " << workers.size() << " shards (" << sendingJobs << " jobs, "
+                << sendingPages << " pages, still being sent)\n";
+        }
+
+        if (printersFail) {
+            std::cout << "Failures: " << GetStalls() << " stalls, " << GetOutages() << " outages, " << GetDownFraction() * 100 << "% of the time down\n";
+        }
+
+        std::cout << "Job Times (s)       Jobs      Mean       p50       p90       p99       Max\n";
+        LogHistogram("Queue wait", queueWaits);
+        LogHistogram("Service", serviceTimes);
+        LogHistogram("Latency", latencies);
+        if (priorityLatencies.size() > 1) {
+            for (int i = 0; i < priorityLatencies.size(); i++) {
+                std::string name = "  Priority " + std::to_string(i);
+                LogHistogram(name.c_str(), priorityLatencies[i]);
+            }
+        }
+        std::cout << "\nStatus of Printers:\n";
+        LogPrinterStatus();
+        Instrumentation::Dump(std::cout);
+    }
+
+    /// <summary>
+    /// Writes a snapshot of the whole simulation between runs: the clock, the printers and their queues, the pending events, the
+    /// random generators, and the job times.  RestoreCheckpoint() carries on from it as if the run had never stopped.
+    /// </summary>
+    /// <returns>False when threaded, since the workers' printers can't be saved as one consistent state.</returns>
+    bool SaveCheckpoint(CheckpointWriter& writer) {
+        if (!workers.empty())
+            return false;
+
+        writer.Write(settings.printers);
+        writer.Write(settings.priorityClasses);
+        writer.Write(settings.queueDiscipline);
+        writer.Write(UsingTrace());
+
+        writer.WriteTime(simulatedTime);
+        writer.WriteTime(startTime);
+        writer.WriteTime(nextArrivalTime);
+        writer.WriteTime(lastUpdate);
+        writer.WriteDuration(maxLag);
+        writer.WriteDuration(totalLag);
+        writer.Write(lagSamples);
+        writer.WriteTime(measureStart);
+        writer.Write(measuring);
+        latencyBatches.Save(writer);
+
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> pending = events;
+        writer.Write(static_cast<std::uint64_t>(pending.size()));
+        while (!pending.empty()) {
+            writer.Write(pending.top());
+            pending.pop();
+        }
+
+        writer.Write(eventCount);
+        writer.Write(arrivalScheduled);
+        writer.Write(jobCount);
+        random.Save(writer);
+        dispatchRandom.Save(writer);
+        priorityRandom.Save(writer);
+        arrivals.Save(writer);
+        writer.Write(roundRobinNext);
+        writer.WriteArray(nextJobSizes, JOB_SIZE_BATCH);
+        writer.Write(nextJobSizeIndex);
+
+        if (UsingTrace()) {
+            writer.Write(trace.GetPosition());
+            writer.Write(nextTraceJob);
+            writer.Write(hasTraceJob);
+            writer.Write(firstTraceArrival);
+        }
+
+        queueWaits.Save(writer);
+        serviceTimes.Save(writer);
+        latencies.Save(writer);
+        for (const Histogram& histogram : priorityLatencies) {
+            histogram.Save(writer);
+        }
+
+        backlog.Save(writer);
+        deferredJobs.Save(writer);
+        writer.Write(rejectedJobs);
+        writer.Write(shedJobs);
+        writer.Write(deferredJobCount);
+
+        //Parts of split jobs can still be printing even if the run carried on from the checkpoint doesn't split
+        writer.Write(splitJobs != nullptr);
+        if (splitJobs) {
+            for (int i = 0; i < MAX_SPLIT_JOBS; i++) {
+                writer.Write(splitJobs[i].partsLeft.load(std::memory_order_relaxed));
+                writer.Write(splitJobs[i].pages);
+            }
+        }
+
+        writer.Write(nextSplitSlot);
+        writer.Write(splitJobCount);
+        writer.Write(splitPartCount);
+        writer.Write(stolenJobs);
+        for (const Printer& printer : printers) {
+            printer.Save(writer);
+        }
+
+        return true;
+    }
+
+    /// <returns>False when threaded or if the file couldn't be written.</returns>
+    bool SaveCheckpoint(const std::string& path) {
+        CheckpointWriter writer;
+        return SaveCheckpoint(writer) && writer.Save(path);
+    }
+
+    /// <summary>
+    /// Carries on from a snapshot written by SaveCheckpoint().  Call it after Setup() with the settings to carry on with, then Run()
+    /// simulates secondsToSimulate more.  The number of printers, priority classes, queue discipline, and whether a trace is replayed
+    /// must be the same as when the snapshot was taken, but anything else can be changed, such as the dispatch and admission policies
+    /// or the printer profiles, so many what-if runs can be forked from one warmed up state.  The events in the snapshot still happen
+    /// as they were scheduled, except those of printers whose profile changed, which are scheduled again (see Printer::Retime()).
+    /// The snapshot isn't needed once this returns.
+    /// </summary>
+    /// <returns>False when threaded, or if the snapshot doesn't match the settings or is damaged.  Setup() must be called again before
+    /// running after a failed restore.</returns>
+    bool RestoreCheckpoint(const char* snapshot, size_t size) {
+        if (settings.engine == SimulationEngine::RealTimeThreaded || settings.engine == SimulationEngine::Sharded)
+            return false;
+
+        CheckpointReader reader(snapshot, size);
+        int savedPrinters = 0;
+        int savedPriorityClasses = 0;
+        QueueDiscipline savedDiscipline = QueueDiscipline::Fifo;
+        bool savedTrace = false;
+        reader.Read(savedPrinters);
+        reader.Read(savedPriorityClasses);
+        reader.Read(savedDiscipline);
+        reader.Read(savedTrace);
+        if (reader.Failed() || savedPrinters != settings.printers || savedPriorityClasses != settings.priorityClasses
+            || savedDiscipline != settings.queueDiscipline || savedTrace != UsingTrace())
+            return false;
+
+        reader.ReadTime(simulatedTime);
+        reader.ReadTime(startTime);
+        reader.ReadTime(nextArrivalTime);
+        reader.ReadTime(lastUpdate);
+        reader.ReadDuration(maxLag);
+        reader.ReadDuration(totalLag);
+        reader.Read(lagSamples);
+        reader.ReadTime(measureStart);
+        reader.Read(measuring);
+        latencyBatches.Restore(reader);
+        steadyState = false;//Checked again when the next batch finishes
+
+        //Setup() scheduled the first failures, which the snapshot already has.  The events are only queued once the printers have
+        //been read, since the events of printers with a changed profile are left out.
+        events = {};
+        std::vector<Event> savedEvents(reader.ReadCount(sizeof(Event)));
+        for (Event& event : savedEvents) {
+            reader.Read(event);
+            bool printerEvent = event.type == EventType::JobCompletion || event.type == EventType::PrinterFailure || event.type == EventType::PrinterRepair;
+            if (event.printerID >= settings.printers || (printerEvent && event.printerID < 0) || event.type == EventType::JobTransfer) {
+                reader.Fail();
+                break;
+            }
+        }
+
+        reader.Read(eventCount);
+        reader.Read(arrivalScheduled);
+        reader.Read(jobCount);
+        random.Restore(reader);
+        dispatchRandom.Restore(reader);
+        priorityRandom.Restore(reader);
+        arrivals.Restore(reader);
+        reader.Read(roundRobinNext);
+        reader.ReadArray(nextJobSizes, JOB_SIZE_BATCH);
+        reader.Read(nextJobSizeIndex);
+
+        if (UsingTrace()) {
+            TracePosition position{};
+            reader.Read(position);
+            reader.Read(nextTraceJob);
+            reader.Read(hasTraceJob);
+            reader.Read(firstTraceArrival);
+            if (!reader.Failed() && !trace.SetPosition(position))
+                reader.Fail();
+        }
+
+        queueWaits.Restore(reader);
+        serviceTimes.Restore(reader);
+        latencies.Restore(reader);
+        for (Histogram& histogram : priorityLatencies) {
+            histogram.Restore(reader);
+        }
+
+        backlog.Restore(reader);
+        deferredJobs.Restore(reader);
+        for (size_t i = 0; i < deferredJobs.Size(); i++) {
+            CheckRestoredJob(reader, deferredJobs[i]);
+        }
+
+        reader.Read(rejectedJobs);
+        reader.Read(shedJobs);
+        reader.Read(deferredJobCount);
+
+        bool hasSplitJobs = false;
+        reader.Read(hasSplitJobs);
+        if (hasSplitJobs) {
+            if (!splitJobs)
+                splitJobs.reset(new SplitJob[MAX_SPLIT_JOBS]);
+
+            for (int i = 0; i < MAX_SPLIT_JOBS; i++) {
+                int partsLeft = 0;
+                reader.Read(partsLeft);
+                reader.Read(splitJobs[i].pages);
+                splitJobs[i].partsLeft.store(partsLeft, std::memory_order_relaxed);
+            }
+        }
+
+        reader.Read(nextSplitSlot);
+        reader.Read(splitJobCount);
+        reader.Read(splitPartCount);
+        reader.Read(stolenJobs);
+        std::vector<bool> retimed(settings.printers, false);
+        for (Printer& printer : printers) {
+            PrinterProfile savedProfile;
+            printer.Restore(reader, savedProfile);
+            retimed[printer.printerID] = !(savedProfile == printer.profile);
+            if (printer.printing)
+                CheckRestoredJob(reader, printer.currentJob);
+
+            for (int level = 0; level < printer.waitingJobs.LevelCount(); level++) {
+                const RingQueue<PrintJob>& jobs = printer.waitingJobs.Level(level);
+                for (size_t i = 0; i < jobs.Size(); i++) {
+                    CheckRestoredJob(reader, jobs[i]);
+                }
+            }
+        }
+
+        if (reader.Failed() || !reader.AtEnd() || nextJobSizeIndex < 0 || nextJobSizeIndex > JOB_SIZE_BATCH || nextSplitSlot < 0 || nextSplitSlot >= MAX_SPLIT_JOBS)
+            return false;
+
+        std::vector<bool> failureScheduled(settings.printers, false);
+        for (const Event& event : savedEvents) {
+            bool printerEvent = event.type == EventType::JobCompletion || event.type == EventType::PrinterFailure || event.type == EventType::PrinterRepair;
+            if (printerEvent && retimed[event.printerID])
+                continue;
+
+            if (event.type == EventType::PrinterFailure || event.type == EventType::PrinterRepair)
+                failureScheduled[event.printerID] = true;
+
+            events.push(event);
+        }
+
+        realTime = std::chrono::high_resolution_clock::now();
+        for (Printer& printer : printers) {
+            //Printers that didn't fail before can with the new profiles
+            if (retimed[printer.printerID]) {
+                printer.Retime();
+            }
+            else if (!failureScheduled[printer.printerID]) {
+                printer.ScheduleFailure();
+            }
+
+            printer.UpdateDispatchIndex();
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Fails the reader if a restored job's priority or split slot can't be used as an index.
+    /// </summary>
+    void CheckRestoredJob(CheckpointReader& reader, const PrintJob& job) const {
+        if (job.Pages < 0 || job.Priority < 0 || job.Priority >= settings.priorityClasses
+            || (job.SplitSlot != -1 && (!splitJobs || job.SplitSlot < 0 || job.SplitSlot >= MAX_SPLIT_JOBS)))
+            reader.Fail();
+    }
+
+    /// <summary>
+    /// RestoreCheckpoint() from a file, which is memory mapped instead of read.
+    /// </summary>
+    bool RestoreCheckpoint(const std::string& path) {
+        MappedFile file;
+        return file.Open(path) && RestoreCheckpoint(file.Data(), file.Size());
+    }
+
+    /// <summary>
+    /// Discards everything measured so far and measures from the simulated time, as at the end of the warm up.  Call it after
+    /// RestoreCheckpoint() to only measure the run carried on from the checkpoint.  When threaded, each worker resets its own printers
+    /// at the end of the warm up instead.
+    /// </summary>
+    void ResetMetrics() {
+        measuring = true;
+        measureStart = simulatedTime;
+        queueWaits.Clear();
+        serviceTimes.Clear();
+        latencies.Clear();
+        for (Histogram& histogram : priorityLatencies) {
+            histogram.Clear();
+        }
+
+        latencyBatches.Reset(settings.latencyBatchJobs);
+        steadyState = false;
+        rejectedJobs = 0;
+        shedJobs = 0;
+        deferredJobCount = 0;
+        splitJobCount = 0;
+        splitPartCount = 0;
+        stolenJobs = 0;
+        backlog.ResetPeaks();
+        for (Printer& printer : printers) {
+            printer.ResetMetrics();
+        }
+    }
+
+    const SimulationSettings& GetSettings() const {
+        return settings;
+    }
+
+    const Histogram& GetQueueWaits() const {
+        return queueWaits;
+    }
+
+    const Histogram& GetServiceTimes() const {
+        return serviceTimes;
+    }
+
+    const Histogram& GetLatencies() const {
+        return latencies;
+    }
+
+    const Histogram& GetLatencies(int priority) const {
+        return priorityLatencies[priority];
+    }
+
+    /// <summary>
+    /// Totals for all of the printers.  When threaded, these are the jobs booked on the printers by the simulated time.
+    /// </summary>
+    const FleetBacklog& GetBacklog() const {
+        return backlog;
+    }
+
+    long long GetRejectedJobs() const {
+        return rejectedJobs;
+    }
+
+    long long GetShedJobs() const {
+        return shedJobs;
+    }
+
+    long long GetDeferredJobs() const {
+        return deferredJobCount;
+    }
+
+    long long GetSplitJobs() const {
+        return splitJobCount;
+    }
+
+    long long GetStolenJobs() const {
+        return stolenJobs;
+    }
+
+    /// <summary>
+    /// The latest the Paced clock woke up for a tick.
+    /// </summary>
+    std::chrono::high_resolution_clock::duration GetMaxLag() const {
+        return maxLag;
+    }
+
+    std::chrono::high_resolution_clock::duration GetMeanLag() const {
+        if (lagSamples == 0)
+            return {};
+
+        return totalLag / lagSamples;
+    }
+
+    int GetJobCount() const {
+        return jobCount;
+    }
+
+    /// <summary>
+    /// Events scheduled so far, including the workers' when threaded.
+    /// </summary>
+    long long GetEventCount() const {
+        long long count = eventCount;
+        for (int i = 0; i < workers.size(); i++) {
+            count += workers[i]->GetEventCount();
+        }
+
+        return count;
+    }
+
+    /// <summary>
+    /// Simulated time since the warm up ended, or since the start if there wasn't one.  Includes the time before a checkpoint that
+    /// the run was carried on from.
+    /// </summary>
+    std::chrono::high_resolution_clock::duration GetMeasuredDuration() const {
+        return simulatedTime - measureStart;
+    }
+
+    /// <summary>
+    /// Batch means of the latencies measured, used to stop at targetPrecision.  Only kept by the printers' own simulation, so it is
+    /// empty on the dispatcher of RealTimeThreaded.
+    /// </summary>
+    const BatchMeans& GetLatencyBatches() const {
+        return latencyBatches;
+    }
+
+    /// <summary>
+    /// True if the run stopped early because the mean latency reached targetPrecision.
+    /// </summary>
+    bool ReachedSteadyState() const {
+        return steadyState;
+    }
+
+    /// <summary>
+    /// Fraction of the simulated time that the printers spent printing.
+    /// </summary>
+    double GetUtilization() {
+        std::chrono::high_resolution_clock::duration busyTime = GetBusyTime();
+        std::chrono::high_resolution_clock::duration availableTime = GetMeasuredDuration() * settings.printers;
+        return static_cast<double>(busyTime.count()) / availableTime.count();
+    }
+
+    /// <summary>
+    /// Fraction of the simulated time that one printer spent printing.
+    /// </summary>
+    double GetUtilization(Printer& printer) {
+        return static_cast<double>(printer.GetBusyTime().count()) / GetMeasuredDuration().count();
+    }
+
+    /// <summary>
+    /// Fraction of the simulated time that the printers spent down.
+    /// </summary>
+    double GetDownFraction() {
+        std::chrono::high_resolution_clock::duration downTime{};
+        ForEachPrinter([&downTime](Printer& printer) { downTime += printer.GetDownTime(); });
+        return static_cast<double>(downTime.count()) / (GetMeasuredDuration().count() * settings.printers);
+    }
+
+    int GetStalls() {
+        int stalls = 0;
+        ForEachPrinter([&stalls](Printer& printer) { stalls += printer.GetStalls(); });
+        return stalls;
+    }
+
+    int GetOutages() {
+        int outages = 0;
+        ForEachPrinter([&outages](Printer& printer) { outages += printer.GetOutages(); });
+        return outages;
+    }
+
+    //Used by the dispatch policies
+
+    int PrinterCount() const {
+        return settings.printers;
+    }
+
+    /// <summary>
+    /// Jobs in the printer's queue.  When threaded, this is the jobs booked on it, which includes the jobs still in its worker's
+    /// inbox.
+    /// </summary>
+    size_t GetQueueLength(int printerID) const {
+        if (!workers.empty())
+            return bookedJobPages[printerID].Size();
+
+        return printers[printerID].GetQueueLength();
+    }
+
+    /// <summary>
+    /// The time the printer is expected to be able to start a new job.  When threaded, this is from the jobs booked on it, so it
+    /// doesn't know about failures.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point GetAvailableTime(int printerID) {
+        if (!workers.empty()) {
+            long long finishTime = bookedFinishTimes[printerID];
+            return finishTime == DispatchIndex::NO_JOBS ? simulatedTime : std::chrono::high_resolution_clock::time_point(std::chrono::high_resolution_clock::duration(finishTime));
+        }
+
+        return printers[printerID].GetFinishTime();
+    }
+
+    /// <summary>
+    /// Time for the printer to print a job once it starts.
+    /// </summary>
+    std::chrono::milliseconds GetPrintTime(int printerID, int pages) const {
+        return GetProfile(printerID).GetPrintTime(pages);
+    }
+
+    /// <summary>
+    /// True if every printer prints a job in the same time, so the printer that finishes its jobs first also finishes a new one first.
+    /// </summary>
+    bool HasUniformSpeeds() const {
+        return uniformSpeeds;
+    }
+
+    int SelectLeastPagesLeft() {
+        if (settings.fleetBackend == FleetBackend::Arrays)
+            return fleetArrays.SelectLeastPagesLeft(static_cast<double>((simulatedTime - startTime).count()), static_cast<double>(TICKS_PER_SHEET));
+
+        return dispatchIndex.SelectLeastPagesLeft(simulatedTime.time_since_epoch().count(), TICKS_PER_SHEET);
+    }
+
+    int SelectEarliestFinish() {
+        if (settings.fleetBackend == FleetBackend::Arrays)
+            return fleetArrays.SelectEarliestFinish();
+
+        return dispatchIndex.SelectEarliestFinish();
+    }
+
+    Random& GetDispatchRandom() {
+        return dispatchRandom;
+    }
+
+    int& GetRoundRobinNext() {
+        return roundRobinNext;
+    }
+
+    /// <returns>The simulatedTime in milliseconds since the clock's epoch.</returns>
+    long long GetTimeMilliseconds() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(simulatedTime.time_since_epoch()).count();
+    }
+
+    /// <summary>
+    /// Writes the simulatedTime in HH:MM:SS format.
+    /// </summary>
+    char* GetTime(char* first, char* last) const {
+        return FormatTime(first, last, GetTimeMilliseconds());
+    }
+
+private:
+    void ScheduleEvent(std::chrono::high_resolution_clock::time_point time, EventType type, int printerID = -1, int generation = 0) {
+        events.push({ time, type, printerID, generation, eventCount++ });
+    }
+
+    void LogJobEvent(LogRecordType type, int printerID, const PrintJob& job) {
+        if (settings.logger != nullptr && settings.logger->IsRecording()) {
+            INSTRUMENT_SCOPE(Log);
+            settings.logger->Log({ GetTimeMilliseconds(), printerID >= 0 ? firstPrinterID + printerID : printerID, job.ID, job.Pages, type });
+        }
+    }
+
+    void LogPrinterStatus() {
+        for (int i = 0; i < printers.size(); i++) {
+            Printer& printer = printers[i];
+            std::cout << printer.Name();
+            std::cout << std::fixed << std::setprecision(1) << " - Utilization: " << GetUtilization(printer) * 100 << "%";
+            if (printersFail)
+                std::cout << ", Down: " << static_cast<double>(printer.GetDownTime().count()) / GetMeasuredDuration().count() * 100 << "%";
+
+            std::cout << ", Total pages left: " << printer.GetTotalPagesLeft() << ", ";
+            printer.LogRemainingJobs();
+            std::cout << std::endl;
+        }
+
+        for (int i = 0; i < workers.size(); i++) {
+            workers[i]->LogPrinterStatus();
+        }
+    }
+
+    void LogBacklog() {
+        std::cout << "Backlog: " << backlog.Pages() << " pages, " << backlog.BusyPrinters() << " of " << settings.printers << " printers busy\n";
+        std::cout << "Printers by jobs in queue:";
+        for (size_t i = 0; i <= backlog.MaxQueueLength(); i++) {
+            int printerCount = backlog.PrintersWithQueueLength(i);
+            if (printerCount > 0)
+                std::cout << " " << i << " jobs: " << printerCount << (i < backlog.MaxQueueLength() ? "," : "");
+        }
+
+        std::cout << "\n";
+        std::cout << "Peak backlog: " << backlog.PeakPages() << " pages, " << backlog.PeakQueueLength() << " jobs on one printer\n";
+    }
+
+    /// <summary>
+    /// Prints a row of the job times table in seconds.
+    /// </summary>
+    static void LogHistogram(const char* name, const Histogram& histogram) {
+        std::cout << std::left << std::setw(14) << name << std::right << std::setw(10) << histogram.Count() << std::fixed << std::setprecision(1)
+            << std::setw(10) << histogram.Mean() / MILLISECONDS_PER_SECOND;
+        const double percentiles[] = { 50, 90, 99 };
+        for (double percentile : percentiles) {
+            std::cout << std::setw(10) << static_cast<double>(histogram.GetPercentile(percentile)) / MILLISECONDS_PER_SECOND;
+        }
+
+        std::cout << std::setw(10) << static_cast<double>(histogram.Max()) / MILLISECONDS_PER_SECOND << "\n";
+    }
+
+    /// <summary>
+    /// Calls function on every printer, including the workers'.
+    /// </summary>
+    template <typename Function>
+    void ForEachPrinter(Function function) {
+        for (Printer& printer : printers) {
+            function(printer);
+        }
+
+        for (int i = 0; i < workers.size(); i++) {
+            workers[i]->ForEachPrinter(function);
+        }
+    }
+
+    /// <param name="printerID">In the whole fleet.</param>
+    const PrinterProfile& GetProfile(int printerID) const {
+        static const PrinterProfile defaultProfile;
+        return settings.printerProfiles.empty() ? defaultProfile : settings.printerProfiles[printerID % settings.printerProfiles.size()];
+    }
+
+    void ScheduleFailures() {
+        for (Printer& printer : printers) {
+            printer.ScheduleFailure();
+        }
+    }
+
+    /// <summary>
+    /// Handles the events of the printers.  A printer's completion is ignored if its job was paused after it was scheduled.
+    /// </summary>
+    void HandlePrinterEvent(const Event& event) {
+        Printer& printer = printers[event.printerID];
+        switch (event.type) {
+        case EventType::JobCompletion:
+            if (event.generation == printer.generation)
+                printer.Update();
+            break;
+        case EventType::PrinterFailure:
+            printer.Fail();
+            break;
+        case EventType::PrinterRepair:
+            printer.Repair();
+            break;
+        case EventType::JobArrival:
+            //Left by the DiscreteEvent engine in a checkpoint.  The RealTime engines create jobs with their clock instead.
+            arrivalScheduled = false;
+            break;
+        case EventType::JobTransfer:
+            //Only used by shards, which are never saved
+            break;
+        }
+    }
+
+    /// <summary>
+    /// Ends the warm up if the simulation is about to move on to a time after it.
+    /// </summary>
+    void CheckWarmUp(std::chrono::high_resolution_clock::time_point time) {
+        if (measuring || time < measureStart)
+            return;
+
+        if (simulatedTime < measureStart)
+            simulatedTime = measureStart;
+
+        ResetMetrics();
+    }
+
+    void LogPrinterEvent(LogRecordType type, int printerID) {
+        if (settings.logger != nullptr && settings.logger->IsRecording()) {
+            INSTRUMENT_SCOPE(Log);
+            settings.logger->Log({ GetTimeMilliseconds(), firstPrinterID + printerID, -1, 0, type });
+        }
+    }
+
+    /// <summary>
+    /// Time spent printing by all of the printers.
+    /// </summary>
+    std::chrono::high_resolution_clock::duration GetBusyTime() {
+        std::chrono::high_resolution_clock::duration busyTime{};
+        for (int i = 0; i < printers.size(); i++) {
+            busyTime += printers[i].GetBusyTime();
+        }
+
+        for (int i = 0; i < workers.size(); i++) {
+            busyTime += workers[i]->GetBusyTime();
+        }
+
+        return busyTime;
+    }
+
+    /// <summary>
+    /// Logs a blank line to separate groups of events.
+    /// </summary>
+    void LogSeparator() {
+        if (settings.logger != nullptr && settings.logger->IsRecording()) {
+            INSTRUMENT_SCOPE(Log);
+            settings.logger->Log({ GetTimeMilliseconds(), -1, -1, 0, LogRecordType::Separator });
+        }
+    }
+
+    /// <summary>
+    /// Creates a random number of pages for a print job from the job size distribution.
+    /// </summary>
+    int GetRandomPrintJob() {
+        if (nextJobSizeIndex == JOB_SIZE_BATCH) {
+            jobSizes->Sample(random, nextJobSizes, JOB_SIZE_BATCH);
+            nextJobSizeIndex = 0;
+        }
+
+        return nextJobSizes[nextJobSizeIndex++];
+    }
+
+    int GetRandomPriority() {
+        if (settings.priorityClasses == 1)
+            return 0;
+
+        return static_cast<int>(priorityRandom.NextBelow(static_cast<std::uint32_t>(settings.priorityClasses)));
+    }
+
+    bool UsingTrace() const {
+        return !settings.traceFile.empty();
+    }
+
+    bool KeepsBacklog() const {
+        return dispatcher == nullptr;
+    }
+
+    /// <summary>
+    /// The simulated time that a job from the trace arrives.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point GetArrivalTime(const TraceJob& job) const {
+        return startTime + std::chrono::milliseconds(job.arrival - firstTraceArrival);
+    }
+
+    /// <summary>
+    /// Adds every job from the trace that has arrived by the simulated time.
+    /// </summary>
+    template <typename Policy>
+    void AddTraceJobs(Policy& policy) {
+        while (hasTraceJob && GetArrivalTime(nextTraceJob) <= simulatedTime) {
+            AddNewJob(policy, nextTraceJob.pages, nextTraceJob.priority);
+            hasTraceJob = NextTraceJob();
+        }
+    }
+
+    /// <returns>False if the trace has no more jobs for this simulation.</returns>
+    bool NextTraceJob() {
+        bool hasJob = true;
+        for (int i = 0; hasJob && i < shardCount; i++) {
+            hasJob = trace.Next(nextTraceJob);
+        }
+
+        return hasJob;
+    }
+
+    /// <summary>
+    /// Creates a new print job and adds it to the printer chosen by the dispatch policy, unless admission control turns it away.
+    /// </summary>
+    template <typename Policy>
+    void AddNewJob(Policy& policy, int jobSize, int priority = 0) {
+        PrintJob job(jobCount++ * shardCount + shardID, jobSize, simulatedTime, std::max(0, std::min(priority, settings.priorityClasses - 1)));
+        LogJobEvent(LogRecordType::JobCreated, -1, job);
+        if (coordinator != nullptr && settings.migrationPages > 0) {
+            int shard = SelectShard(jobSize);
+            if (shard != shardID) {
+                SendToShard(shard, job);
+                return;
+            }
+        }
+
+        if (settings.admissionPolicy == AdmissionPolicy::Defer) {
+            AddDeferredJobs(policy);
+
+            //Wait behind the jobs that are still deferred so they keep their order
+            if (!deferredJobs.Empty()) {
+                DeferJob(job);
+                return;
+            }
+        }
+
+        int selectedForNewJob = SelectPrinter(policy, jobSize);
+        if (settings.admissionPolicy != AdmissionPolicy::AcceptAll && IsOverloaded(selectedForNewJob, jobSize)) {
+            switch (settings.admissionPolicy) {
+            case AdmissionPolicy::Reject:
+                TurnAwayJob(LogRecordType::JobRejected, job);
+                return;
+            case AdmissionPolicy::Defer:
+                DeferJob(job);
+                return;
+            case AdmissionPolicy::ShedLarge:
+                if (jobSize > settings.shedPages) {
+                    TurnAwayJob(LogRecordType::JobShed, job);
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        DispatchJob(policy, selectedForNewJob, job);
+    }
+
+    template <typename Policy>
+    int SelectPrinter(Policy& policy, int jobSize) {
+        INSTRUMENT_SCOPE(Dispatch);
+        return policy.Select(*this, jobSize);
+    }
+
+    /// <summary>
+    /// Adds the job to the printer.
+    /// </summary>
+    void SendJob(int printerID, const PrintJob& job) {
+        if (!workers.empty()) {
+            HandOff(printerID, job);
+            return;
+        }
+
+        printers[printerID].Print(job);
+        LogSeparator();
+    }
+
+    /// <summary>
+    /// Sends the job to the selected printer, or splits it if it is large.
+    /// </summary>
+    template <typename Policy>
+    void DispatchJob(Policy& policy, int printerID, const PrintJob& job) {
+        int parts = GetSplitParts(job.Pages);
+        int slot = parts > 1 ? FindSplitSlot() : -1;
+        if (slot < 0) {
+            SendJob(printerID, job);
+            return;
+        }
+
+        SplitJob& splitJob = splitJobs[slot];
+        splitJob.pages = job.Pages;
+        splitJob.partsLeft.store(parts, std::memory_order_relaxed);//Published to the workers by handing them the parts
+        splitJobCount++;
+        splitPartCount += parts;
+        LogJobEvent(LogRecordType::JobSplit, -1, job);
+
+        //The first part goes to the printer already selected for the job.  Each part after that is dispatched after the parts
+        //before it have been added, so the parts spread over the most lightly loaded printers.
+        PrintJob part = job;
+        part.SplitSlot = slot;
+        for (int i = 0; i < parts; i++) {
+            part.Pages = job.Pages / parts + (i < job.Pages % parts ? 1 : 0);
+            SendJob(i == 0 ? printerID : SelectPrinter(policy, part.Pages), part);
+        }
+    }
+
+    /// <returns>The number of parts to split a job into, which is 1 if it shouldn't be split.</returns>
+    int GetSplitParts(int jobSize) const {
+        if (settings.splitPages <= 0 || jobSize <= settings.splitPages)
+            return 1;
+
+        int parts = (jobSize + settings.splitPages - 1) / settings.splitPages;
+        return std::min(parts, std::min(settings.maxSplitParts, settings.printers));
+    }
+
+    /// <returns>A slot with no parts left, or -1 if every slot is in use.</returns>
+    int FindSplitSlot() {
+        for (int i = 0; i < MAX_SPLIT_JOBS; i++) {
+            int slot = nextSplitSlot;
+            nextSplitSlot = (nextSplitSlot + 1) % MAX_SPLIT_JOBS;
+            if (splitJobs[slot].partsLeft.load(std::memory_order_acquire) == 0)
+                return slot;
+        }
+
+        return -1;
+    }
+
+    /// <summary>
+    /// Records the latency of a job when it has finished, or when its last part has if it was split.
+    /// </summary>
+    void FinishJob(const PrintJob& job) {
+        //Every part frees room in the backlog, not only the last
+        if (!deferredJobs.Empty())
+            retryDeferredJobs = true;
+
+        int pages = job.Pages;
+        if (job.SplitSlot >= 0) {
+            SplitJob& splitJob = (dispatcher != nullptr ? dispatcher : this)->splitJobs[job.SplitSlot];
+            pages = splitJob.pages;//Read before the part is counted, since the slot can be reused as soon as the last one is
+            if (splitJob.partsLeft.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+
+            PrintJob wholeJob = job;
+            wholeJob.Pages = pages;
+            LogJobEvent(LogRecordType::JobPartsFinished, -1, wholeJob);
+        }
+
+        long long latency = std::chrono::duration_cast<std::chrono::milliseconds>(simulatedTime - job.Created).count();
+        latencies.Record(latency);
+        priorityLatencies[job.Priority].Record(latency);
+        if (latencyBatches.Record(static_cast<double>(latency)) && settings.targetPrecision > 0)
+            steadyState = latencyBatches.IsPrecise(settings.targetPrecision, settings.minLatencyBatches);
+    }
+
+    /// <summary>
+    /// Gives a printer that has run out of jobs a waiting job of the most loaded printer.  Nothing is taken from a printer with
+    /// only its current job.
+    /// </summary>
+    void StealJob(Printer& thief) {
+        if (dispatcher != nullptr) {
+            StealSharedJob(thief);
+            return;
+        }
+
+        //O(1) check, since most of the time no printer has a job waiting.  A printer that is down can have one waiting job.
+        if (backlog.MaxQueueLength() < 2 && !printersFail)
+            return;
+
+        Printer* victim = nullptr;
+        for (Printer& printer : printers) {
+            if (printer.GetWaitingJobs() > 0 && (victim == nullptr || printer.GetFinishTime() > victim->GetFinishTime()))
+                victim = &printer;
+        }
+
+        PrintJob job;
+        if (victim == nullptr || !victim->GiveAwayJob(job))
+            return;
+
+        stolenJobs++;
+        LogJobEvent(LogRecordType::JobStolen, thief.printerID, job);
+        thief.Print(job);
+    }
+
+    /// <summary>
+    /// StealJob() for a worker.  The other workers' printers can't be read, so the victim is the printer with the longest queue the
+    /// dispatcher knows of.  Its job is only taken if it wouldn't have started by this worker's time anyway, since the workers' clocks
+    /// can be apart.
+    /// </summary>
+    void StealSharedJob(Printer& thief) {
+        int thiefID = firstPrinterID + thief.printerID;
+        int victimID = -1;
+        int longestQueue = 1;
+        for (int i = 0; i < dispatcher->settings.printers; i++) {
+            int queueLength = dispatcher->queueLengths[i].load(std::memory_order_relaxed);
+            if (i != thiefID && queueLength > longestQueue) {
+                victimID = i;
+                longestQueue = queueLength;
+            }
+        }
+
+        if (victimID < 0)
+            return;
+
+        Simulation& victimWorker = *dispatcher->workers[dispatcher->printerWorkers[victimID]];
+        Printer& victim = victimWorker.printers[victimID - victimWorker.firstPrinterID];
+        if (victim.sharedJobs->currentFinish.load(std::memory_order_relaxed) <= simulatedTime.time_since_epoch().count())
+            return;
+
+        PrintJob job;
+        if (!victim.GiveAwayJob(job))
+            return;
+
+        //Stops other thieves picking the same printer until its worker updates it
+        dispatcher->queueLengths[victimID].fetch_sub(1, std::memory_order_relaxed);
+
+        //Dropped if the dispatcher is behind, which only leaves its bookings out of date.  Waiting could deadlock with the
+        //dispatcher waiting for room in this worker's inbox.
+        dispatcher->stealReports.TryPush({ victimID, thiefID, job.Pages });
+        stolenJobs++;
+        LogJobEvent(LogRecordType::JobStolen, thief.printerID, job);
+        thief.Print(job);
+    }
+
+    bool IsOverloaded(int printerID, int jobSize) const {
+        if (settings.maxBacklogPages > 0 && backlog.Pages() + jobSize > settings.maxBacklogPages)
+            return true;
+
+        return settings.maxQueueLength > 0 && GetQueueLength(printerID) >= static_cast<size_t>(settings.maxQueueLength);
+    }
+
+    /// <summary>
+    /// Tries the deferred jobs again if a job has finished since they were last tried.  Called once the events being handled are
+    /// done, so the deferred jobs aren't dispatched while a printer is in the middle of moving on to its next job.
+    /// </summary>
+    template <typename Policy>
+    void RetryDeferredJobs(Policy& policy) {
+        if (!retryDeferredJobs)
+            return;
+
+        retryDeferredJobs = false;
+        AddDeferredJobs(policy);
+    }
+
+    /// <summary>
+    /// Sends the deferred jobs to printers, oldest first, until the fleet is overloaded again.
+    /// </summary>
+    template <typename Policy>
+    void AddDeferredJobs(Policy& policy) {
+        while (!deferredJobs.Empty()) {
+            PrintJob job = deferredJobs.Front();
+            int selected = SelectPrinter(policy, job.Pages);
+            if (IsOverloaded(selected, job.Pages))
+                return;
+
+            deferredJobs.Pop();
+            DispatchJob(policy, selected, job);
+        }
+    }
+
+    void DeferJob(const PrintJob& job) {
+        if (deferredJobs.Size() >= static_cast<size_t>(settings.maxDeferredJobs)) {
+            TurnAwayJob(LogRecordType::JobRejected, job);
+            return;
+        }
+
+        deferredJobs.Push(job);
+        deferredJobCount++;
+        LogJobEvent(LogRecordType::JobDeferred, -1, job);
+        LogSeparator();
+    }
+
+    /// <param name="type">JobRejected or JobShed.</param>
+    void TurnAwayJob(LogRecordType type, const PrintJob& job) {
+        if (type == LogRecordType::JobShed) {
+            shedJobs++;
+        }
+        else {
+            rejectedJobs++;
+        }
+
+        LogJobEvent(type, -1, job);
+        LogSeparator();
+    }
+
+    template <typename Policy>
+    void Update(Policy& policy) {
+        INSTRUMENT_SCOPE(SimulationUpdate);
+
+        //Update the printers whose current job is complete.  They are updated in printer order to match updating every printer.
+        //Failures and repairs are handled after them in the order they happened, as if they were at the end of the tick.
+        finishedPrinters.clear();
+        printerEvents.clear();
+        while (!events.empty() && events.top().time <= simulatedTime) {
+            const Event& event = events.top();
+            if (event.type != EventType::JobCompletion) {
+                printerEvents.push_back(event);
+            }
+            else if (event.generation == printers[event.printerID].generation) {
+                finishedPrinters.push_back(event.printerID);
+            }
+
+            events.pop();
+        }
+
+        std::sort(finishedPrinters.begin(), finishedPrinters.end());
+        for (int i = 0; i < finishedPrinters.size(); i++) {
+            Printer& printer = printers[finishedPrinters[i]];
+            printer.Update();
+        }
+
+        for (int i = 0; i < printerEvents.size(); i++) {
+            HandlePrinterEvent(printerEvents[i]);
+        }
+
+        RetryDeferredJobs(policy);
+        AddDueJobs(policy);
+    }
+
+    /// <summary>
+    /// Adds the jobs that have arrived since the last update.
+    /// </summary>
+    template <typename Policy>
+    void AddDueJobs(Policy& policy) {
+        if (UsingTrace()) {
+            AddTraceJobs(policy);
+            return;
+        }
+
+        //Gaps can be shorter than a tick, so every job that has arrived is added
+        while (simulatedTime >= nextArrivalTime) {
+            nextArrivalTime = GetNextArrival();
+            AddNewJob(policy, GetRandomPrintJob(), GetRandomPriority());
+        }
+    }
+
+    /// <returns>The arrival after nextArrivalTime.</returns>
+    std::chrono::high_resolution_clock::time_point GetNextArrival() {
+        return startTime + arrivals.Next(nextArrivalTime - startTime);
+    }
+
+    /// <summary>
+    /// Checks if 1 simulated second has passed since the last update.
+    /// </summary>
+    bool ShouldUpdate() {
+        long long timeSinceLastUpdate = std::chrono::duration_cast<std::chrono::milliseconds>(simulatedTime - lastUpdate).count();
+        //Update simulation once per simulated second.
+        if (timeSinceLastUpdate >= MILLISECONDS_PER_SECOND) {
+            lastUpdate += std::chrono::milliseconds(MILLISECONDS_PER_SECOND);
+            return true;
+        }
+
+        return false;
+    }
+
+    /// <summary>
+    /// Advances the simulated time with the real clock and updates the simulation once per simulated second.
+    /// </summary>
+    void AdvanceSimulatedTime() {
+        std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+        long long timeSinceLastUpdate = std::chrono::duration_cast<std::chrono::microseconds>(now - realTime).count();
+        realTime += std::chrono::microseconds(timeSinceLastUpdate);
+        //Increase the simulated time by the amount of time that has passed since the last update multiplied by the simulation speed
+        simulatedTime += std::chrono::microseconds(timeSinceLastUpdate * settings.simulationSpeed);
+    }
+
+    template <typename Policy>
+    void RunRealTime(Policy& policy) {
+        RunClock(policy);
+    }
+
+    /// <summary>
+    /// One tick of the RealTime engines.
+    /// </summary>
+    template <typename Policy>
+    void UpdateTick(Policy& policy) {
+        if (workers.empty()) {
+            Update(policy);
+        }
+        else {
+            UpdateDispatcher(policy);
+        }
+    }
+
+    /// <summary>
+    /// Lets the workers see the simulated time.  Must be called after the jobs up to the time have been handed out, so a worker
+    /// that sees the new time also sees every job handed out before it.
+    /// </summary>
+    void PublishClock() {
+        if (!workers.empty())
+            clock.store(simulatedTime.time_since_epoch().count(), std::memory_order_release);
+    }
+
+    /// <summary>
+    /// The next tick that needs an update.  Ticks where nothing finishes and no job arrives are skipped, except when threaded
+    /// because the workers only move forward when the clock does.
+    /// </summary>
+    std::chrono::high_resolution_clock::time_point GetNextTick() const {
+        std::chrono::seconds tickLength(1);
+        if (!workers.empty())
+            return lastUpdate + tickLength;
+
+        std::chrono::high_resolution_clock::time_point next = std::chrono::high_resolution_clock::time_point::max();
+        if (UsingTrace()) {
+            if (hasTraceJob)
+                next = GetArrivalTime(nextTraceJob);
+        }
+        else {
+            next = nextArrivalTime;
+        }
+
+        if (!events.empty() && events.top().time < next)
+            next = events.top().time;
+
+        if (next == std::chrono::high_resolution_clock::time_point::max())
+            return next;
+
+        if (next <= lastUpdate)
+            return lastUpdate + tickLength;
+
+        //Round up to a whole number of ticks
+        long long ticks = (next - lastUpdate + tickLength - std::chrono::high_resolution_clock::duration(1)) / tickLength;
+        return lastUpdate + tickLength * ticks;
+    }
+
+    /// <summary>
+    /// Runs the clock of the RealTime engines until secondsToSimulate have passed.
+    /// </summary>
+    template <typename Policy>
+    void RunClock(Policy& policy) {
+        std::chrono::high_resolution_clock::time_point end = simulatedTime + std::chrono::seconds(settings.secondsToSimulate);
+        if (settings.clockMode == ClockMode::Polling) {
+            while (simulatedTime < end && !steadyState) {
+                AdvanceSimulatedTime();
+                CheckWarmUp(simulatedTime);
+                if (ShouldUpdate())
+                    UpdateTick(policy);
+
+                PublishClock();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            return;
+        }
+
+        //The simulated time is always worked out from the start instead of added up, so rounding errors don't build up
+        std::chrono::high_resolution_clock::time_point realStart = std::chrono::high_resolution_clock::now();
+        std::chrono::high_resolution_clock::time_point simulatedStart = simulatedTime;
+        while (true) {
+            std::chrono::high_resolution_clock::time_point tick = GetNextTick();
+            if (tick > end || steadyState)
+                break;
+
+            std::chrono::high_resolution_clock::time_point due = realStart + (tick - simulatedStart) / settings.simulationSpeed;
+            std::this_thread::sleep_until(due);
+            realTime = std::chrono::high_resolution_clock::now();
+            std::chrono::high_resolution_clock::duration lag = realTime - due;
+            maxLag = std::max(maxLag, lag);
+            totalLag += lag;
+            lagSamples++;
+
+            //Catch up on every tick that is due by now.  Checked against the length of the run first so the multiply can't overflow.
+            std::chrono::high_resolution_clock::duration realElapsed = realTime - realStart;
+            std::chrono::high_resolution_clock::time_point reached = end;
+            if (realElapsed < (end - simulatedStart) / settings.simulationSpeed)
+                reached = simulatedStart + realElapsed * settings.simulationSpeed;
+
+            while (tick <= reached && tick <= end && !steadyState) {
+                CheckWarmUp(tick);
+                simulatedTime = tick;
+                lastUpdate = tick;
+                UpdateTick(policy);
+                tick = GetNextTick();
+            }
+
+            PublishClock();
+        }
+
+        //A run that reached a steady state ends at the update that reached it
+        if (!steadyState) {
+            CheckWarmUp(end);
+            simulatedTime = end;
+        }
+
+        PublishClock();
+    }
+
+    /// <summary>
+    /// Splits the printers into contiguous groups and creates a worker simulation for each group.
+    /// </summary>
+    /// <returns>False if a worker couldn't be set up.</returns>
+    bool SetupWorkers() {
+        int workerCount = settings.workerThreads > 0 ? settings.workerThreads : static_cast<int>(std::thread::hardware_concurrency());
+        workerCount = std::max(1, std::min(workerCount, settings.printers));
+        bookedFinishTimes.assign(settings.printers, DispatchIndex::NO_JOBS);
+        bookingGenerations.assign(settings.printers, 0);
+        bookedJobPages.resize(settings.printers);
+        if (settings.workStealing)
+            stealReports.Reset(JOB_HANDOFF_CAPACITY);
+
+        queueLengths.reset(new std::atomic<int>[settings.printers]);
+        printerWorkers.resize(settings.printers);
+        for (int i = 0; i < settings.printers; i++) {
+            bookedJobPages[i].Clear();
+            queueLengths[i].store(0, std::memory_order_relaxed);
+        }
+
+        SimulationSettings workerSettings = settings;
+        workerSettings.engine = SimulationEngine::RealTime;
+        workerSettings.traceFile.clear();
+        workerSettings.targetPrecision = 0;
+        for (int w = 0; w < workerCount; w++) {
+            int first = static_cast<int>(static_cast<long long>(settings.printers) * w / workerCount);
+            int last = static_cast<int>(static_cast<long long>(settings.printers) * (w + 1) / workerCount);
+            for (int i = first; i < last; i++) {
+                printerWorkers[i] = w;
+            }
+
+            std::unique_ptr<Simulation> worker(new Simulation());
+            worker->dispatcher = this;
+            worker->firstPrinterID = first;
+            workerSettings.printers = last - first;
+            if (!worker->Setup(workerSettings))
+                return false;
+
+            worker->simulatedTime = simulatedTime;
+            worker->startTime = startTime;
+            worker->measureStart = measureStart;
+            worker->ScheduleFailures();
+            worker->inbox.Reset(JOB_HANDOFF_CAPACITY);
+            workers.push_back(std::move(worker));
+        }
+
+        return true;
+    }
+
+    void UpdateBooking(int printerID) {
+        long long finishTime = bookedFinishTimes[printerID];
+        if (settings.fleetBackend == FleetBackend::Arrays) {
+            fleetArrays.Update(printerID, finishTime == DispatchIndex::NO_JOBS ? FleetArrays::NO_JOBS : static_cast<double>(finishTime - startTime.time_since_epoch().count()));
+        }
+        else {
+            dispatchIndex.Update(printerID, finishTime);
+        }
+    }
+
+    /// <summary>
+    /// Books the job on the printer and hands it to the printer's worker.
+    /// </summary>
+    void HandOff(int printerID, const PrintJob& job) {
+        Book(printerID, job.Pages);
+        Simulation& worker = *workers[printerWorkers[printerID]];
+        worker.inbox.Push({ job, printerID - worker.firstPrinterID });
+    }
+
+    /// <summary>
+    /// Adds a job to the end of the jobs booked on the printer.
+    /// </summary>
+    void Book(int printerID, int pages) {
+        long long& finishTime = bookedFinishTimes[printerID];
+        if (finishTime == DispatchIndex::NO_JOBS)
+            finishTime = simulatedTime.time_since_epoch().count();
+
+        finishTime += GetPrintTicks(printerID, pages);
+        UpdateBooking(printerID);
+        RingQueue<int>& jobPages = bookedJobPages[printerID];
+        jobPages.Push(pages);
+        backlog.JobQueued(pages, jobPages.Size());
+        if (jobPages.Size() == 1)
+            backlog.JobStarted();
+
+        //The printer is free again once this completion passes, unless it is handed another job first
+        ScheduleEvent(std::chrono::high_resolution_clock::time_point(std::chrono::high_resolution_clock::duration(finishTime)), EventType::JobCompletion, printerID, bookingGenerations[printerID]);
+    }
+
+    /// <summary>
+    /// Removes a job that hasn't started from the jobs booked on the printer.  The jobs after it finish sooner, so every job still
+    /// booked has its completion scheduled again.
+    /// </summary>
+    /// <param name="index">Of the job in bookedJobPages.  Must not be 0, which is the job printing.</param>
+    void Unbook(int printerID, size_t index) {
+        RingQueue<int>& jobPages = bookedJobPages[printerID];
+        int pages = jobPages[index];
+        size_t count = jobPages.Size();
+        for (size_t i = 0; i < count; i++) {
+            int jobPagesLeft = jobPages.Front();
+            jobPages.Pop();
+            if (i != index)
+                jobPages.Push(jobPagesLeft);
+        }
+
+        backlog.JobRemoved(pages, jobPages.Size());
+        long long& finishTime = bookedFinishTimes[printerID];
+        finishTime -= GetPrintTicks(printerID, pages);
+        UpdateBooking(printerID);
+
+        //The jobs still booked follow each other without a gap, so their completions are worked out back from the last
+        int generation = ++bookingGenerations[printerID];
+        long long completion = finishTime;
+        for (size_t i = jobPages.Size(); i-- > 0;) {
+            ScheduleEvent(std::chrono::high_resolution_clock::time_point(std::chrono::high_resolution_clock::duration(completion)), EventType::JobCompletion, printerID, generation);
+            completion -= GetPrintTicks(printerID, jobPages[i]);
+        }
+    }
+
+    /// <summary>
+    /// Moves the bookings of the jobs the workers' printers have stolen to the thieves.  A job the dispatcher expects to have
+    /// started already is left alone, since its booking has passed.
+    /// </summary>
+    void MoveStolenBookings() {
+        JobSteal steal;
+        while (stealReports.TryPop(steal)) {
+            //The thief takes the oldest job that hasn't started, which is the first booked with its pages after the one printing
+            const RingQueue<int>& victimPages = bookedJobPages[steal.victimID];
+            size_t index = 1;
+            while (index < victimPages.Size() && victimPages[index] != steal.pages) {
+                index++;
+            }
+
+            if (index >= victimPages.Size())
+                continue;
+
+            Unbook(steal.victimID, index);
+            Book(steal.thiefID, steal.pages);
+        }
+    }
+
+    long long GetPrintTicks(int printerID, int pages) const {
+        return std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(GetPrintTime(printerID, pages)).count();
+    }
+
+    /// <summary>
+    /// Frees the printers that have finished all of their jobs, then adds the jobs that have arrived.
+    /// </summary>
+    template <typename Policy>
+    void UpdateDispatcher(Policy& policy) {
+        if (settings.workStealing)
+            MoveStolenBookings();
+
+        while (!events.empty() && events.top().time <= simulatedTime) {
+            Event event = events.top();
+            events.pop();
+            if (event.generation != bookingGenerations[event.printerID])
+                continue;
+
+            //Each job booked on a printer has its own completion, and they pass in the order the jobs were booked
+            RingQueue<int>& jobPages = bookedJobPages[event.printerID];
+            backlog.JobFinished(jobPages.Front(), jobPages.Size() - 1);
+            jobPages.Pop();
+            if (!jobPages.Empty())
+                backlog.JobStarted();
+
+            if (bookedFinishTimes[event.printerID] == event.time.time_since_epoch().count()) {
+                bookedFinishTimes[event.printerID] = DispatchIndex::NO_JOBS;
+                UpdateBooking(event.printerID);
+            }
+
+            //The workers finish the jobs, so the dispatcher retries its deferred jobs when their bookings pass
+            if (!deferredJobs.Empty())
+                retryDeferredJobs = true;
+        }
+
+        RetryDeferredJobs(policy);
+        AddDueJobs(policy);
+    }
+
+    /// <summary>
+    /// RealTime with a thread for each worker.  This thread advances the clock and hands out the jobs.
+    /// </summary>
+    template <typename Policy>
+    void RunRealTimeThreaded(Policy& policy) {
+        clock.store(simulatedTime.time_since_epoch().count(), std::memory_order_relaxed);
+        workersStopping.store(false, std::memory_order_relaxed);
+        for (int i = 0; i < workers.size(); i++) {
+            threads.push_back(std::thread(&Simulation::RunWorker, workers[i].get()));
+        }
+
+        RunClock(policy);
+        workersStopping.store(true, std::memory_order_release);
+        for (int i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+
+        threads.clear();
+        for (int i = 0; i < workers.size(); i++) {
+            queueWaits.Merge(workers[i]->queueWaits);
+            serviceTimes.Merge(workers[i]->serviceTimes);
+            latencies.Merge(workers[i]->latencies);
+            for (int p = 0; p < priorityLatencies.size(); p++) {
+                priorityLatencies[p].Merge(workers[i]->priorityLatencies[p]);
+            }
+
+            stolenJobs += workers[i]->stolenJobs;
+        }
+    }
+
+    /// <summary>
+    /// Updates the printers whose jobs finish by the time, at the time each one finishes.
+    /// </summary>
+    void CompleteJobs(std::chrono::high_resolution_clock::time_point time) {
+        while (!events.empty() && events.top().time <= time) {
+            Event event = events.top();
+            events.pop();
+            CheckWarmUp(event.time);
+            simulatedTime = event.time;
+            HandlePrinterEvent(event);
+        }
+
+        CheckWarmUp(time);
+    }
+
+    /// <summary>
+    /// Worker thread.  Prints the jobs handed to this group of printers as the dispatcher's clock passes them.
+    /// </summary>
+    void RunWorker() {
+        JobHandoff handoff;
+        while (true) {
+            //Read before the clock, so the last pass sees the final time and every job
+            bool stopping = dispatcher->workersStopping.load(std::memory_order_acquire);
+            std::chrono::high_resolution_clock::time_point now(std::chrono::high_resolution_clock::duration(dispatcher->clock.load(std::memory_order_acquire)));
+            while (inbox.TryPop(handoff)) {
+                CompleteJobs(handoff.job.Created);
+                simulatedTime = handoff.job.Created;
+                printers[handoff.printerID].Print(handoff.job);
+                LogSeparator();
+            }
+
+            CompleteJobs(now);
+            if (simulatedTime < now)
+                simulatedTime = now;
+
+            if (stopping)
+                break;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    /// <summary>
+    /// Processes events in time order, jumping the simulated time straight to each event instead of waiting for the real clock.
+    /// </summary>
+    template <typename Policy>
+    void RunDiscreteEvent(Policy& policy) {
+        std::chrono::high_resolution_clock::time_point end = simulatedTime + std::chrono::seconds(settings.secondsToSimulate);
+        ScheduleArrival();
+        while (!steadyState && !events.empty() && events.top().time <= end) {
+            HandleNextEvent(policy);
+        }
+
+        //A run that reached a steady state ends at the event that reached it
+        if (!steadyState) {
+            CheckWarmUp(end);
+            simulatedTime = end;
+        }
+    }
+
+    /// <summary>
+    /// Schedules the first JobArrival of a DiscreteEvent run, unless one was left by the last run.
+    /// </summary>
+    void ScheduleArrival() {
+        if (arrivalScheduled)
+            return;
+
+        if (UsingTrace()) {
+            if (hasTraceJob)
+                ScheduleEvent(GetArrivalTime(nextTraceJob), EventType::JobArrival);
+        }
+        else {
+            ScheduleEvent(nextArrivalTime, EventType::JobArrival);
+        }
+
+        arrivalScheduled = true;
+    }
+
+    /// <summary>
+    /// Moves the simulated time to the earliest event and processes it.
+    /// </summary>
+    template <typename Policy>
+    void HandleNextEvent(Policy& policy) {
+        Event event = events.top();
+        events.pop();
+        CheckWarmUp(event.time);
+        simulatedTime = event.time;
+        switch (event.type) {
+        case EventType::JobCompletion:
+        case EventType::PrinterFailure:
+        case EventType::PrinterRepair:
+            HandlePrinterEvent(event);
+            RetryDeferredJobs(policy);
+            break;
+        case EventType::JobArrival:
+            if (UsingTrace()) {
+                //Every job arriving at this time is added at once, so only one arrival is ever scheduled
+                AddTraceJobs(policy);
+                arrivalScheduled = hasTraceJob;
+                if (hasTraceJob)
+                    ScheduleEvent(GetArrivalTime(nextTraceJob), EventType::JobArrival);
+            }
+            else {
+                //Kept the same way as the RealTime engines, so a checkpoint can be carried on with either
+                nextArrivalTime = GetNextArrival();
+                AddNewJob(policy, GetRandomPrintJob(), GetRandomPriority());
+                ScheduleEvent(nextArrivalTime, EventType::JobArrival);
+            }
+            break;
+        case EventType::JobTransfer: {
+            //Transfers are scheduled in the order they arrive, so the earliest is always at the front
+            PrintJob job = incomingTransfers.Front().job;
+            incomingTransfers.Pop();
+            DispatchJob(policy, SelectPrinter(policy, job.Pages), job);
+            break;
+        }
+        }
+    }
+
+    /// <summary>
+    /// Splits the printers into contiguous groups and creates a shard for each group.
+    /// </summary>
+    /// <returns>False if a shard couldn't be set up, such as when it can't open the trace.</returns>
+    bool SetupShards() {
+        int shardTotal = settings.shards > 0 ? settings.shards : static_cast<int>(std::thread::hardware_concurrency());
+        shardTotal = std::max(1, std::min(shardTotal, settings.printers));
+        shardLoads.assign(shardTotal, 0);
+        SimulationSettings shardSettings = settings;
+        shardSettings.engine = SimulationEngine::DiscreteEvent;
+        shardSettings.targetPrecision = 0;
+        shardSettings.secondsPerJob = settings.secondsPerJob * shardTotal;
+        for (int s = 0; s < shardTotal; s++) {
+            int first = static_cast<int>(static_cast<long long>(settings.printers) * s / shardTotal);
+            int last = static_cast<int>(static_cast<long long>(settings.printers) * (s + 1) / shardTotal);
+            std::unique_ptr<Simulation> shard(new Simulation());
+            shard->coordinator = this;
+            shard->shardID = s;
+            shard->shardCount = shardTotal;
+            shard->firstPrinterID = first;
+            shardSettings.printers = last - first;
+            if (!shard->Setup(shardSettings))
+                return false;
+
+            shard->mailbox.Reset(JOB_TRANSFER_CAPACITY);
+            workers.push_back(std::move(shard));
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Runs every shard on its own thread until secondsToSimulate have passed, then totals their results.
+    /// </summary>
+    void RunSharded() {
+        runEnd = simulatedTime + std::chrono::seconds(settings.secondsToSimulate);
+        windowEnd = simulatedTime;
+        shardsDone = false;
+        shardsWaiting.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < workers.size(); i++) {
+            threads.push_back(std::thread([this, i] { workers[i]->Run(); }));
+        }
+
+        for (int i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+
+        threads.clear();
+        CheckWarmUp(runEnd);
+        simulatedTime = runEnd;
+        CollectShards();
+    }
+
+    /// <summary>
+    /// Shard thread.  Each window, takes in the jobs sent to this shard in the last window, waits for the coordinator to plan the
+    /// window, processes this shard's events in it, then waits until every shard has sent its jobs for the window.
+    /// </summary>
+    template <typename Policy>
+    void RunShard(Policy& policy) {
+        Simulation& group = *coordinator;
+        ScheduleArrival();
+        while (true) {
+            DrainMailbox();
+            ScheduleTransfers();
+            nextShardEvent = events.empty() ? std::chrono::high_resolution_clock::time_point::max() : events.top().time;
+            group.shardLoads[shardID] = KeptLoad();
+            group.WaitForShards(*this, true);
+            if (group.shardsDone)
+                break;
+
+            shardLoads = group.shardLoads;
+            while (!events.empty() && (events.top().time < group.windowEnd || (group.finalWindow && events.top().time <= group.windowEnd))) {
+                HandleNextEvent(policy);
+            }
+
+            group.WaitForShards(*this, false);
+        }
+
+        CheckWarmUp(group.runEnd);
+        simulatedTime = group.runEnd;
+    }
+
+    /// <summary>
+    /// Barrier for the shards.  The last shard to arrive plans the next window if asked to, then lets the others go.  Shards that
+    /// are waiting keep emptying their mailbox, so a shard that is still sending them jobs can't get stuck on a full one.
+    /// </summary>
+    void WaitForShards(Simulation& shard, bool planWindow) {
+        int generation = barrierGeneration.load(std::memory_order_acquire);
+        if (shardsWaiting.fetch_add(1, std::memory_order_acq_rel) + 1 == static_cast<int>(workers.size())) {
+            shardsWaiting.store(0, std::memory_order_relaxed);
+            if (planWindow)
+                PlanWindow();
+
+            barrierGeneration.store(generation + 1, std::memory_order_release);
+            return;
+        }
+
+        while (barrierGeneration.load(std::memory_order_acquire) == generation) {
+            shard.DrainMailbox();
+            std::this_thread::yield();
+        }
+    }
+
+    /// <summary>
+    /// The next window starts at the earliest event of any shard.  A job sent in it can't arrive until migrationSeconds after it
+    /// was sent, so every event before then is safe to process without waiting for the other shards.
+    /// </summary>
+    void PlanWindow() {
+        std::chrono::high_resolution_clock::time_point next = std::chrono::high_resolution_clock::time_point::max();
+        long long fleetPages = 0;
+        for (int i = 0; i < workers.size(); i++) {
+            next = std::min(next, workers[i]->nextShardEvent);
+            fleetPages += workers[i]->backlog.Pages();
+        }
+
+        //The shards' own peaks can be at different times, so the fleet's peak is only known at the ends of the windows
+        if (windowEnd >= measureStart)
+            fleetPeakPages = std::max(fleetPeakPages, fleetPages);
+
+        if (next > runEnd) {
+            shardsDone = true;
+            return;
+        }
+
+        std::chrono::high_resolution_clock::time_point lookaheadEnd = next + std::chrono::seconds(settings.migrationSeconds);
+        windowEnd = std::min(lookaheadEnd, runEnd);
+        finalWindow = windowEnd == runEnd;
+    }
+
+    /// <returns>Backlog pages per printer of this shard.</returns>
+    double KeptLoad() const {
+        return static_cast<double>(backlog.Pages()) / std::max(1, settings.printers);
+    }
+
+    /// <summary>
+    /// The least loaded shard, from the loads at the start of the window and the jobs this shard has sent it since.
+    /// </summary>
+    /// <returns>This shard unless it is migrationPages per printer more loaded than the least loaded shard.</returns>
+    int SelectShard(int jobSize) {
+        int leastLoaded = shardID;
+        for (int i = 0; i < shardLoads.size(); i++) {
+            if (shardLoads[i] < shardLoads[leastLoaded])
+                leastLoaded = i;
+        }
+
+        if (leastLoaded == shardID || KeptLoad() - shardLoads[leastLoaded] <= settings.migrationPages)
+            return shardID;
+
+        shardLoads[leastLoaded] += static_cast<double>(jobSize) / std::max(1, coordinator->workers[leastLoaded]->settings.printers);
+        return leastLoaded;
+    }
+
+    /// <summary>
+    /// Sends a new job to another shard, where it arrives migrationSeconds from now.
+    /// </summary>
+    void SendToShard(int shard, const PrintJob& job) {
+        LogJobEvent(LogRecordType::JobMigrated, -1, job);
+        migratedJobs++;
+        JobTransfer transfer = { job, simulatedTime + std::chrono::seconds(settings.migrationSeconds), shardID, sentTransfers++ };
+        MpscQueue<JobTransfer>& destination = coordinator->workers[shard]->mailbox;
+        while (!destination.TryPush(transfer)) {
+            //The other shard might be waiting for room in this shard's mailbox
+            DrainMailbox();
+            std::this_thread::yield();
+        }
+    }
+
+    void DrainMailbox() {
+        JobTransfer transfer;
+        while (mailbox.TryPop(transfer)) {
+            receivedTransfers.push_back(transfer);
+        }
+    }
+
+    /// <summary>
+    /// Schedules the jobs sent in the last window.  They are sorted first, so the order they were taken out of the mailbox in doesn't
+    /// matter.  Every one of them arrives after the transfers scheduled before, since they were sent in a later window.
+    /// </summary>
+    void ScheduleTransfers() {
+        std::sort(receivedTransfers.begin(), receivedTransfers.end(), [](const JobTransfer& a, const JobTransfer& b) {
+            if (a.arrival != b.arrival)
+                return a.arrival < b.arrival;
+
+            if (a.fromShard != b.fromShard)
+                return a.fromShard < b.fromShard;
+
+            return a.sequence < b.sequence;
+        });
+
+        for (const JobTransfer& transfer : receivedTransfers) {
+            incomingTransfers.Push(transfer);
+            ScheduleEvent(transfer.arrival, EventType::JobTransfer);
+        }
+
+        receivedTransfers.clear();
+    }
+
+    /// <summary>
+    /// Totals the shards' results on the coordinator, so it reports them like a single simulation.
+    /// </summary>
+    void CollectShards() {
+        jobCount = 0;
+        rejectedJobs = 0;
+        shedJobs = 0;
+        deferredJobCount = 0;
+        splitJobCount = 0;
+        splitPartCount = 0;
+        stolenJobs = 0;
+        migratedJobs = 0;
+        queueWaits.Clear();
+        serviceTimes.Clear();
+        latencies.Clear();
+        for (Histogram& histogram : priorityLatencies) {
+            histogram.Clear();
+        }
+
+        backlog.Clear(0);
+        for (int i = 0; i < workers.size(); i++) {
+            Simulation& shard = *workers[i];
+            queueWaits.Merge(shard.queueWaits);
+            serviceTimes.Merge(shard.serviceTimes);
+            latencies.Merge(shard.latencies);
+            for (int p = 0; p < priorityLatencies.size(); p++) {
+                priorityLatencies[p].Merge(shard.priorityLatencies[p]);
+            }
+
+            jobCount += shard.jobCount;
+            rejectedJobs += shard.rejectedJobs;
+            shedJobs += shard.shedJobs;
+            deferredJobCount += shard.deferredJobCount;
+            splitJobCount += shard.splitJobCount;
+            splitPartCount += shard.splitPartCount;
+            stolenJobs += shard.stolenJobs;
+            migratedJobs += shard.migratedJobs;
+            backlog.Merge(shard.backlog);
+        }
+
+        backlog.RecordPeakPages(fleetPeakPages);
+    }
+};
+
+//Printer functions that use the simulation are defined here because they need the full Simulation class.
+
+inline void Printer::Update() {
+    INSTRUMENT_SCOPE(PrinterUpdate);
+    if (!printing || down)
+        return;
+
+    //If the job is complete, start the next job
+    if (JobComplete()) {
+        simulation->LogJobEvent(LogRecordType::JobFinished, printerID, currentJob);
+        busyTime += simulation->simulatedTime - start - paused;
+        simulation->serviceTimes.Record(std::chrono::duration_cast<std::chrono::milliseconds>(simulation->simulatedTime - start).count());
+        simulation->FinishJob(currentJob);
+        totalPagesRemaining -= currentJob.Pages;
+        if (simulation->KeepsBacklog())
+            simulation->backlog.JobFinished(currentJob.Pages, GetWaitingJobs());
+
+        printing = false;
+        CheckStartNextJob();
+        UpdateDispatchIndex();
+        if (IsIdle() && simulation->settings.workStealing)
+            simulation->StealJob(*this);
+
+        simulation->LogSeparator();
+    }
+}
+
+inline int Printer::GetPagesPrinted() const {
+    if (!printing)
+        return 0;
+
+    auto timeSinceStart = std::chrono::duration_cast<std::chrono::milliseconds>(GetPrintedUntil() - start - paused);
+    long long pagesPrinted = (timeSinceStart.count() - profile.setupMilliseconds) / profile.GetMillisecondsPerSheet();
+    if (pagesPrinted < 0)
+        return 0;
+
+    return pagesPrinted < currentJob.Pages ? static_cast<int>(pagesPrinted) : currentJob.Pages;
+}
+
+inline std::chrono::high_resolution_clock::time_point Printer::GetPrintedUntil() const {
+    return down ? downSince : simulation->simulatedTime;
+}
+
+inline std::chrono::high_resolution_clock::time_point Printer::GetFinishTime() {
+    std::chrono::high_resolution_clock::time_point resume = simulation->simulatedTime;
+    if (down && expectedUp > resume)
+        resume = expectedUp;
+
+    //Jobs that haven't started still need their setup
+    std::chrono::milliseconds waitingTime(static_cast<long long>(GetWaitingJobs()) * profile.setupMilliseconds);
+    if (!printing)
+        return resume + waitingTime + std::chrono::milliseconds(static_cast<long long>(GetQueuedPages()) * profile.GetMillisecondsPerSheet());
+
+    std::chrono::high_resolution_clock::duration pause = down ? resume - downSince : std::chrono::high_resolution_clock::duration::zero();
+    return start + paused + pause + std::chrono::milliseconds(profile.setupMilliseconds) + waitingTime
+        + std::chrono::milliseconds(static_cast<long long>(GetQueuedPages()) * profile.GetMillisecondsPerSheet());
+}
+
+inline std::chrono::high_resolution_clock::duration Printer::GetDownTime() {
+    if (!down)
+        return downTime;
+
+    return downTime + (simulation->simulatedTime - downSince);
+}
+
+inline void Printer::ScheduleFailure() {
+    if (profile.meanSecondsBetweenFailures > 0)
+        simulation->ScheduleEvent(simulation->simulatedTime + GetRandomTime(profile.meanSecondsBetweenFailures), EventType::PrinterFailure, printerID);
+}
+
+inline void Printer::Fail() {
+    bool outage = failureRandom.NextDouble() < profile.outageFraction;
+    int meanSeconds = outage ? profile.meanSecondsToRepair : profile.meanSecondsToClearStall;
+    down = true;
+    inOutage = outage;
+    downSince = simulation->simulatedTime;
+    expectedUp = downSince + std::chrono::seconds(meanSeconds);
+    if (outage) {
+        outages++;
+    }
+    else {
+        stalls++;
+    }
+
+    //The job is rescheduled when the printer is back up
+    if (printing) {
+        generation++;
+        if (sharedJobs)
+            sharedJobs->currentFinish.store(std::numeric_limits<long long>::max(), std::memory_order_relaxed);
+    }
+
+    simulation->ScheduleEvent(downSince + GetRandomTime(meanSeconds), EventType::PrinterRepair, printerID);
+    simulation->LogPrinterEvent(outage ? LogRecordType::PrinterOutage : LogRecordType::PrinterStalled, printerID);
+    UpdateDispatchIndex();
+    simulation->LogSeparator();
+}
+
+inline void Printer::Repair() {
+    std::chrono::high_resolution_clock::duration outage = simulation->simulatedTime - downSince;
+    downTime += outage;
+    down = false;
+    simulation->LogPrinterEvent(LogRecordType::PrinterRepaired, printerID);
+    if (printing) {
+        paused += outage;
+        simulation->ScheduleEvent(GetJobFinishTime(), EventType::JobCompletion, printerID, generation);
+        if (sharedJobs)
+            sharedJobs->currentFinish.store(GetJobFinishTime().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+    else {
+        CheckStartNextJob();
+    }
+
+    ScheduleFailure();
+    UpdateDispatchIndex();
+    simulation->LogSeparator();
+}
+
+inline void Printer::Retime() {
+    if (down) {
+        //The job is rescheduled when the printer is back up, which schedules the next failure
+        int meanSeconds = inOutage ? profile.meanSecondsToRepair : profile.meanSecondsToClearStall;
+        expectedUp = downSince + std::chrono::seconds(meanSeconds);
+        simulation->ScheduleEvent(simulation->simulatedTime + GetRandomTime(meanSeconds), EventType::PrinterRepair, printerID);
+        return;
+    }
+
+    if (printing) {
+        //A faster profile can have finished the job already
+        generation++;
+        simulation->ScheduleEvent(std::max(GetJobFinishTime(), simulation->simulatedTime), EventType::JobCompletion, printerID, generation);
+    }
+
+    ScheduleFailure();
+}
+
+inline void Printer::Print(PrintJob job) {
+    INSTRUMENT_SCOPE(Print);
+    if (sharedJobs) {
+        sharedJobs->jobs.Push(job);
+    }
+    else {
+        waitingJobs.Push(job);
+    }
+
+    simulation->LogJobEvent(LogRecordType::JobQueued, printerID, job);
+    totalPagesRemaining += job.Pages;
+    if (simulation->KeepsBacklog())
+        simulation->backlog.JobQueued(job.Pages, GetQueueLength());
+
+    CheckStartNextJob();
+
+    UpdateDispatchIndex();
+}
+
+inline void Printer::CheckStartNextJob() {
+    if (!IsIdle() || down)
+        return;
+
+    if (sharedJobs) {
+        if (!sharedJobs->jobs.Pop(currentJob))
+            return;
+
+        sharedJobs->currentFinish.store((simulation->simulatedTime + profile.GetPrintTime(currentJob.Pages)).time_since_epoch().count(), std::memory_order_relaxed);
+    }
+    else {
+        if (waitingJobs.Empty())
+            return;
+
+        currentJob = waitingJobs.Pop();
+    }
+
+    start = simulation->simulatedTime;
+    paused = {};
+    printing = true;
+    if (simulation->KeepsBacklog())
+        simulation->backlog.JobStarted();
+
+    simulation->LogJobEvent(LogRecordType::JobStarted, printerID, currentJob);
+    simulation->queueWaits.Record(std::chrono::duration_cast<std::chrono::milliseconds>(start - currentJob.Created).count());
+
+    //The completion time is known as soon as the job starts, so only the printers with a finished job need to be updated
+    simulation->ScheduleEvent(GetJobFinishTime(), EventType::JobCompletion, printerID, generation);
+}
+
+inline bool Printer::GiveAwayJob(PrintJob& job) {
+    if (sharedJobs) {
+        if (!sharedJobs->jobs.TryPop(job))
+            return false;
+
+        //Only this printer's worker writes totalPagesRemaining
+        sharedJobs->stolenPages.fetch_add(job.Pages, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (waitingJobs.Empty())
+        return false;
+
+    job = waitingJobs.PopBack();
+    totalPagesRemaining -= job.Pages;
+    simulation->backlog.JobRemoved(job.Pages, GetQueueLength());
+    UpdateDispatchIndex();
+    return true;
+}
+
+inline std::chrono::high_resolution_clock::duration Printer::GetBusyTime() {
+    if (IsIdle())
+        return busyTime;
+
+    return busyTime + (GetPrintedUntil() - start - paused);
+}
+
+inline void Printer::UpdateDispatchIndex() {
+    //A worker's printers are only chosen by the dispatcher, which only needs to know their queue lengths
+    if (simulation->dispatcher != nullptr) {
+        simulation->dispatcher->queueLengths[simulation->firstPrinterID + printerID].store(static_cast<int>(GetQueueLength()), std::memory_order_relaxed);
+        return;
+    }
+
+    if (simulation->settings.fleetBackend == FleetBackend::Arrays) {
+        simulation->fleetArrays.Update(printerID, IsAvailable() ? FleetArrays::NO_JOBS : static_cast<double>((GetFinishTime() - simulation->startTime).count()));
+    }
+    else {
+        simulation->dispatchIndex.Update(printerID, IsAvailable() ? DispatchIndex::NO_JOBS : GetFinishTime().time_since_epoch().count());
+    }
+}
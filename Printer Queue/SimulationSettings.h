@@ -0,0 +1,241 @@
+/*
+Description - Settings of a simulation: the engine that runs it, the printers' profiles, admission control, and the distribution of
+    job sizes.  Kept apart from Simulation.h so the printers can be built from them without the whole simulation.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AliasTable.h"
+#include "ArrivalProcess.h"
+#include "DispatchPolicy.h"
+#include "JobQueue.h"
+#include "Logger.h"
+
+//Constants
+const int MILLISECONDS_PER_SECOND = 1000;
+const int SECONDS_PER_MINUTE = 60;
+const int MINUTES_PER_HOUR = 60;
+const int HOURS_PER_DAY = 24;
+const int MILLISECONDS_PER_DAY = MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE * MINUTES_PER_HOUR * HOURS_PER_DAY;
+const int SHEETS_PER_MINUTE = 7;
+const int MAX_SHEETS_PER_MINUTE = MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE;//Print times are whole milliseconds per sheet
+const int MILLISECONDS_PER_SHEET = MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE / SHEETS_PER_MINUTE;
+
+/// <summary>
+/// The time it takes to print one sheet in high_resolution_clock ticks.
+/// </summary>
+const long long TICKS_PER_SHEET = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::milliseconds(MILLISECONDS_PER_SHEET)).count();
+
+/// <summary>
+/// RealTime advances the simulation with the real clock at the simulation speed.
+/// RealTimeThreaded is RealTime with the printers split into groups that each run on their own worker thread.  Jobs are handed
+/// to the workers through lock-free queues, and each worker finishes its printers' jobs at their exact completion times.  The
+/// workers log at the same time, so events from different printers can be written out of order.
+/// DiscreteEvent ignores the real clock and jumps straight from one event to the next, running as fast as possible.
+/// Sharded is DiscreteEvent with the printers split into shards, such as the sites of a large fleet, that each have their own share
+/// of the jobs and their own events and run on their own thread.  A shard whose printers fall behind the least loaded shard sends
+/// its new jobs there, and they take migrationSeconds to arrive.  Since nothing a shard does can reach another shard sooner than
+/// that, every shard can safely process its events up to migrationSeconds after the earliest event of any shard before they
+/// exchange the jobs that were sent.  The results only depend on the settings, not on how the threads happen to run.
+/// </summary>
+enum class SimulationEngine {
+    RealTime,
+    RealTimeThreaded,
+    DiscreteEvent,
+    Sharded
+};
+
+/// <summary>
+/// How the RealTime engines follow the real clock.  The simulation is updated once per simulated second (a tick) either way.
+/// Polling wakes up every millisecond and does at most one tick each time, so it falls behind when the simulation speed needs more
+/// than 1000 ticks per real second.
+/// Paced sleeps until the next tick that has something to do, then does every tick that is due at the simulated time of each tick,
+/// so it never falls behind for long and the results don't depend on how long the sleeps actually took.
+/// </summary>
+enum class ClockMode {
+    Polling,
+    Paced
+};
+
+/// <summary>
+/// How the simulation finds the printer with the least pages left for a new job.  Both pick the same printer.
+/// Heap keeps the printers in an indexed heap (DispatchIndex), which takes O(log N) per job.
+/// Arrays keeps the printers' finish times in a contiguous array (FleetArrays) and scans all of them with SIMD instructions.
+/// </summary>
+enum class FleetBackend {
+    Heap,
+    Arrays
+};
+
+/// <summary>
+/// What happens to a new job when the fleet is overloaded, which is when its pages would take the backlog past maxBacklogPages or
+/// the printer chosen for it already has maxQueueLength jobs.
+/// AcceptAll ignores the limits.
+/// Reject drops the job.
+/// Defer holds the job and tries it again, oldest first, each time a job finishes or a new job arrives.  At most maxDeferredJobs are held, and jobs
+/// past that are rejected.  The time a job is held counts as queue wait.
+/// ShedLarge drops the job if it has more than shedPages pages and accepts it otherwise.
+/// </summary>
+enum class AdmissionPolicy {
+    AcceptAll,
+    Reject,
+    Defer,
+    ShedLarge
+};
+
+/// <summary>
+/// Speed and reliability of a model of printer.  Failures come at random with the mean time between them, whether or not the
+/// printer is printing.  A failure is either a stall, such as running out of paper, or an outage that needs a repair, and each
+/// takes a random time with its mean to fix.  The current job pauses while the printer is down and carries on where it stopped.
+/// </summary>
+struct PrinterProfile {
+    int sheetsPerMinute = SHEETS_PER_MINUTE;
+    int setupMilliseconds = 0;//Warm up before each job starts printing
+    int meanSecondsBetweenFailures = 0;//0 never fails
+    double outageFraction = 0;//Failures that are outages instead of stalls
+    int meanSecondsToClearStall = 60;
+    int meanSecondsToRepair = SECONDS_PER_MINUTE * MINUTES_PER_HOUR;//Outages
+
+    int GetMillisecondsPerSheet() const {
+        return MILLISECONDS_PER_SECOND * SECONDS_PER_MINUTE / sheetsPerMinute;
+    }
+
+    /// <summary>
+    /// Time to print a job from when it starts, including the setup.
+    /// </summary>
+    std::chrono::milliseconds GetPrintTime(int pages) const {
+        return std::chrono::milliseconds(setupMilliseconds + static_cast<long long>(pages) * GetMillisecondsPerSheet());
+    }
+
+    bool operator==(const PrinterProfile& other) const {
+        return sheetsPerMinute == other.sheetsPerMinute && setupMilliseconds == other.setupMilliseconds
+            && meanSecondsBetweenFailures == other.meanSecondsBetweenFailures && outageFraction == other.outageFraction
+            && meanSecondsToClearStall == other.meanSecondsToClearStall && meanSecondsToRepair == other.meanSecondsToRepair;
+    }
+};
+
+/// <summary>
+/// Settings for a single simulation.
+/// </summary>
+struct SimulationSettings {
+    int printers = 4;
+    int simulationSpeed = 300;//Simulated seconds per real second
+    int secondsToSimulate = SECONDS_PER_MINUTE * 30;
+    double secondsPerJob = 30;//Mean time between random jobs
+    ArrivalSettings arrivals;//When the random jobs arrive (see ArrivalProcess)
+    SimulationEngine engine = SimulationEngine::RealTime;
+    ClockMode clockMode = ClockMode::Paced;
+    FleetBackend fleetBackend = FleetBackend::Heap;
+    DispatchPolicy dispatchPolicy = DispatchPolicy::LeastPagesLeft;
+    int workerThreads = 0;//RealTimeThreaded only.  0 uses one per hardware thread.  Never more than one per printer.
+    //Sharded only.  0 uses one per hardware thread.  Never more than one per printer.  Each shard has an equal share of the jobs.
+    int shards = 0;
+    int migrationSeconds = 10;//Sharded only.  Time for a job to reach another shard, which is also how far ahead shards can run.
+    //Sharded only.  A shard sends a new job to the least loaded shard when its own backlog is this many pages per printer more.  0
+    //never sends jobs to another shard.
+    int migrationPages = 0;
+    AdmissionPolicy admissionPolicy = AdmissionPolicy::AcceptAll;
+    long long maxBacklogPages = 0;//Pages queued or printing on all printers.  0 is no limit.
+    int maxQueueLength = 0;//Jobs queued or printing on one printer.  0 is no limit.
+    int shedPages = 50;//ShedLarge only
+    int maxDeferredJobs = 1000;//Defer only
+    QueueDiscipline queueDiscipline = QueueDiscipline::Fifo;
+    int priorityClasses = 1;//From 1 to JobQueue::MAX_LEVELS.  Random jobs are given one at random, and trace priorities are clamped to them.
+    int splitPages = 0;//Jobs with more pages are split into parts of at most this many pages on different printers.  0 never splits.
+    int maxSplitParts = 4;
+    //A printer that finishes its last job takes the newest waiting job of the printer that will finish last.  RealTimeThreaded
+    //printers share their queues in a lock-free queue instead, so they print in Fifo order and thieves take the oldest waiting job.
+    bool workStealing = false;
+    std::vector<PrinterProfile> printerProfiles;//Printer i uses profile i % size.  Empty makes every printer a PrinterProfile().
+    //Job times, utilization, failures, and admission counts are only measured after this much of secondsToSimulate has passed, so the
+    //empty queues at the start don't bias them.  A job is measured if it starts or finishes after the warm up.
+    int warmUpSeconds = 0;
+    //Stops the run early once the 95% confidence interval of the mean latency is within this fraction of the mean, such as 0.05 for
+    //±5%.  The interval is from the means of batches of latencyBatchJobs jobs.  0 always runs for secondsToSimulate.  Not used by
+    //RealTimeThreaded or Sharded.
+    double targetPrecision = 0;
+    int latencyBatchJobs = 100;
+    int minLatencyBatches = 10;
+    unsigned long long seed = 0;//The same seed and stream always create the same jobs
+    unsigned long long stream = 0;
+    const AliasTable* jobSizes = nullptr;//Distribution of pages per job.  nullptr uses GetDefaultJobSizes().
+    std::string traceFile;//Job log to replay instead of creating random jobs (see JobTrace).  Empty creates random jobs.
+    Logger* logger = nullptr;//Job events and the final status are only written if there is a logger
+};
+
+/// <summary>
+/// The built in job size distribution.  Lower numbers of pages are more likely.
+/// </summary>
+inline const AliasTable& GetDefaultJobSizes() {
+    static const AliasTable jobSizes = [] {
+        std::vector<int> pages;
+        std::vector<double> weights;
+        for (int i = 1; i <= 99; i++) {
+            pages.push_back(i);
+            if (i <= 10) {
+                weights.push_back(0.4 / 10);//40% chance for 1-10 pages
+            }
+            else if (i <= 25) {
+                weights.push_back(0.3 / 15);//30% chance for 11-25 pages
+            }
+            else if (i <= 50) {
+                weights.push_back(0.2 / 25);//20% chance for 26-50 pages
+            }
+            else {
+                weights.push_back(0.1 / 49);//10% chance for 51-99 pages
+            }
+        }
+
+        return AliasTable(pages, weights);
+    }();
+
+    return jobSizes;
+}
+
+/// <summary>
+/// Builds a job size distribution from a print log.  Each line is either the page count of one job, or a page count and
+/// how many jobs had that many pages separated by a comma.  Blank lines, lines starting with #, and lines that don't start
+/// with a number (such as a header) are skipped.
+/// </summary>
+/// <returns>False if the file couldn't be read or had no jobs.</returns>
+inline bool LoadJobSizes(const std::string& path, AliasTable& jobSizes) {
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::map<int, double> jobsByPages;
+    std::string line;
+    while (std::getline(file, line)) {
+        const char* text = line.c_str();
+        char* end;
+        long pages = std::strtol(text, &end, 10);
+        if (end == text || pages <= 0)
+            continue;
+
+        double count = 1;
+        while (*end == ' ' || *end == '\t')
+            end++;
+
+        if (*end == ',')
+            count = std::strtod(end + 1, nullptr);
+
+        jobsByPages[static_cast<int>(pages)] += count;
+    }
+
+    std::vector<int> pages;
+    std::vector<double> weights;
+    for (const auto& entry : jobsByPages) {
+        pages.push_back(entry.first);
+        weights.push_back(entry.second);
+    }
+
+    jobSizes.Build(pages, weights);
+    return jobSizes.Size() > 0;
+}
@@ -0,0 +1,134 @@
+/*
+Description - Unbounded lock-free queue that one thread, the owner, pushes to and any number of threads pop from.  The owner adds
+    values to the bottom and every thread, the owner included, takes them from the top with the same compare and swap, so values
+    come out in the order they were added.  The ring buffer grows like the one in Chase and Lev's work stealing deque, but unlike
+    their deque the owner doesn't pop from the bottom.  Used by RealTimeThreaded work stealing so a printer on one worker can take
+    jobs that are waiting for a printer on another while its own printer still prints them oldest first.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+template <typename T>
+class SpmcQueue {
+    struct Buffer {
+        long long capacity;//Must be a power of 2
+        std::unique_ptr<T[]> slots;
+
+        explicit Buffer(long long bufferCapacity) : capacity(bufferCapacity), slots(new T[bufferCapacity]) {}
+
+        T& operator[](long long index) {
+            return slots[index & (capacity - 1)];
+        }
+    };
+
+    alignas(64) std::atomic<long long> top{ 0 };
+    alignas(64) std::atomic<long long> bottom{ 0 };
+    std::atomic<Buffer*> buffer{ nullptr };
+
+    //Only used by the owner.  Buffers that have been outgrown are kept until Reset(), since a thief may still be reading one.
+    std::vector<std::unique_ptr<Buffer>> buffers;
+public:
+    SpmcQueue() {}
+
+    SpmcQueue(const SpmcQueue&) = delete;
+    SpmcQueue& operator=(const SpmcQueue&) = delete;
+
+    /// <summary>
+    /// Empties the queue.  Keeps the largest buffer.  Must not be called while other threads are using the queue.
+    /// </summary>
+    void Reset() {
+        if (buffers.empty()) {
+            buffers.push_back(std::unique_ptr<Buffer>(new Buffer(16)));
+        }
+        else if (buffers.size() > 1) {
+            std::unique_ptr<Buffer> largest = std::move(buffers.back());
+            buffers.clear();
+            buffers.push_back(std::move(largest));
+        }
+
+        buffer.store(buffers.back().get(), std::memory_order_relaxed);
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(0, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Adds a value to the bottom.  Only the owner can call this.
+    /// </summary>
+    void Push(const T& value) {
+        long long b = bottom.load(std::memory_order_relaxed);
+        long long t = top.load(std::memory_order_acquire);
+        Buffer* current = buffer.load(std::memory_order_relaxed);
+        if (b - t >= current->capacity)
+            current = Grow(current, t, b);
+
+        (*current)[b] = value;
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// Takes the value at the top.  Safe to call from any thread.
+    /// </summary>
+    /// <returns>False if the queue is empty or another thread took the value first.</returns>
+    bool TryPop(T& value) {
+        long long t = top.load(std::memory_order_seq_cst);
+        long long b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b)
+            return false;
+
+        T copy = (*buffer.load(std::memory_order_acquire))[t];
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return false;
+
+        value = copy;
+        return true;
+    }
+
+    /// <summary>
+    /// Takes the value at the top, retrying if other threads take it first.
+    /// </summary>
+    /// <returns>False if the queue is empty.</returns>
+    bool Pop(T& value) {
+        while (!Empty()) {
+            if (TryPop(value))
+                return true;
+        }
+
+        return false;
+    }
+
+    /// <summary>
+    /// Can be out of date as soon as it returns if other threads are stealing.
+    /// </summary>
+    size_t Size() const {
+        long long size = bottom.load(std::memory_order_acquire) - top.load(std::memory_order_acquire);
+        return size > 0 ? static_cast<size_t>(size) : 0;
+    }
+
+    bool Empty() const {
+        return Size() == 0;
+    }
+
+    /// <summary>
+    /// The value index places from the top.  Only valid while no other threads are using the queue.
+    /// </summary>
+    const T& operator[](size_t index) const {
+        return (*buffer.load(std::memory_order_relaxed))[top.load(std::memory_order_relaxed) + static_cast<long long>(index)];
+    }
+
+private:
+    Buffer* Grow(Buffer* current, long long t, long long b) {
+        Buffer* larger = new Buffer(current->capacity * 2);
+        for (long long i = t; i < b; i++) {
+            (*larger)[i] = (*current)[i];
+        }
+
+        buffers.push_back(std::unique_ptr<Buffer>(larger));
+        buffer.store(larger, std::memory_order_release);
+        return larger;
+    }
+};
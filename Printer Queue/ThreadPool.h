@@ -0,0 +1,161 @@
+/*
+Description - Work stealing thread pool.  Each worker has its own task queue and takes tasks from the front of it.  A worker with
+    nothing left to do steals from the back of the other workers' queues, so long tasks don't leave the other workers idle.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextWorker{ 0 };
+    std::atomic<int> queuedTasks{ 0 };//Tasks waiting in a queue
+    std::atomic<int> unfinishedTasks{ 0 };//Tasks waiting in a queue or running
+    std::mutex stateMutex;
+    std::condition_variable taskAdded;
+    std::condition_variable allTasksFinished;
+    bool stopping = false;
+public:
+    /// <param name="threadCount">Number of worker threads.  0 uses one thread per hardware thread.</param>
+    explicit ThreadPool(int threadCount = 0) {
+        if (threadCount <= 0)
+            threadCount = static_cast<int>(std::thread::hardware_concurrency());
+
+        if (threadCount <= 0)
+            threadCount = 1;
+
+        for (int i = 0; i < threadCount; i++) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+
+        for (int i = 0; i < threadCount; i++) {
+            threads.push_back(std::thread(&ThreadPool::Run, this, i));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+
+        taskAdded.notify_all();
+        for (int i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+    int ThreadCount() const {
+        return static_cast<int>(threads.size());
+    }
+
+    /// <summary>
+    /// Queues a task.  Tasks are spread across the workers' queues in turn.
+    /// </summary>
+    void Submit(std::function<void()> task) {
+        Worker& worker = *workers[nextWorker++ % workers.size()];
+        unfinishedTasks++;
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queuedTasks++;
+        }
+
+        taskAdded.notify_one();
+    }
+
+    /// <summary>
+    /// Waits until every submitted task has finished.
+    /// </summary>
+    void Wait() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        allTasksFinished.wait(lock, [this] { return unfinishedTasks == 0; });
+    }
+
+private:
+    bool TryTake(int workerIndex, std::function<void()>& task) {
+        //Own queue first
+        {
+            Worker& worker = *workers[workerIndex];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (worker.tasks.size() > 0) {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+                return true;
+            }
+        }
+
+        //Steal from the back of another worker's queue
+        for (int i = 1; i < workers.size(); i++) {
+            Worker& victim = *workers[(workerIndex + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.size() > 0) {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// <summary>
+    /// Claims one of the queued tasks without locking, so no other worker goes looking for a task that has already been taken.
+    /// </summary>
+    /// <returns>False if no tasks are queued.</returns>
+    bool TryClaim() {
+        int queued = queuedTasks.load(std::memory_order_relaxed);
+        while (queued > 0) {
+            if (queuedTasks.compare_exchange_weak(queued, queued - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+
+        return false;
+    }
+
+    void Run(int workerIndex) {
+        std::function<void()> task;
+        while (true) {
+            //The state mutex is only for sleeping when there is nothing to do.  Submit() adds to queuedTasks under it, so a worker
+            //that finds no tasks can't miss the wake up for the next one.
+            if (!TryClaim()) {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                taskAdded.wait(lock, [this] { return queuedTasks > 0 || stopping; });
+                if (queuedTasks == 0)
+                    return;
+
+                continue;
+            }
+
+            //Every claim has a task in some queue, but one pass over the queues can miss it while other workers take theirs
+            while (!TryTake(workerIndex, task)) {
+                std::this_thread::yield();
+            }
+
+            task();
+            task = nullptr;
+            if (--unfinishedTasks == 0) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                allTasksFinished.notify_all();
+            }
+        }
+    }
+};